@@ -2,18 +2,23 @@
 #include <assert.h>
 #include <getopt.h>
 #include <limits.h>
+#include <malloc.h>
+#include <math.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <time.h>
+#include <x86intrin.h>
 
 #include "common.h"
 #include "atomics.h"
 #include "skip-list.h"
+#include "placement.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // CONFIGURATION
@@ -21,10 +26,32 @@
 #define ALG_TYPE_PURE                   (0)
 #define ALG_TYPE_HAZARD_POINTERS        (1)
 #define ALG_TYPE_STACK_TRACK            (2)
+#define ALG_TYPE_EBR                    (3)
+#define ALG_TYPE_IBR                    (4)
 
 #define DEFAULT_ALG_TYPE			    (ALG_TYPE_PURE)
 #define DEFAULT_MAX_SEGMENT_LEN         (50)
 #define DEFAULT_MAX_FREE_LIST           (100)
+#define DEFAULT_SCAN_MODE               (ST_SCAN_MODE_BATCH)
+#define DEFAULT_SCAN_KERNEL             (ST_SCAN_KERNEL_AUTO)
+#define DEFAULT_THREAD_CHURN            (0)
+#define DEFAULT_RECLAIMERS              (0)
+#define DEFAULT_ALLOCATOR               (ST_ALLOC_MALLOC)
+#define DEFAULT_PREALLOC                (1)
+#define DEFAULT_HTM_BACKEND             (HTM_BACKEND_AUTO)
+#define DEFAULT_WARM_START              (1)
+#define DEFAULT_SPLIT_POLICY            (ST_SPLIT_POLICY_ADDITIVE)
+#define DEFAULT_LATENCY                 (LATENCY_PERCENTILES)
+#define DEFAULT_REPEAT                  (1)
+#define DEFAULT_FORMAT                  (FORMAT_TEXT)
+#define DEFAULT_KEY_DIST                (KEY_DIST_UNIFORM)
+#define DEFAULT_ZIPF_THETA              (0.99)
+#define DEFAULT_HOT_OPS                 (90)
+#define DEFAULT_HOT_KEYS                (10)
+#define DEFAULT_WINDOW_STEP             (100)
+#define DEFAULT_PLACEMENT               (PLACEMENT_NONE)
+#define DEFAULT_MEM_INTERVAL            (0)
+#define DEFAULT_INTERVAL                (0)
 #define DEFAULT_SLOW_PATH_PROB          (0)
 #define DEFAULT_DURATION                (10000)
 #define DEFAULT_INITIAL                 (256)
@@ -32,6 +59,53 @@
 #define DEFAULT_RANGE                   (DEFAULT_INITIAL * 2)
 #define DEFAULT_SEED                    (0)
 #define DEFAULT_UPDATE                  (20)
+#define DEFAULT_VALUE_UPDATE            (0)
+
+#define FORMAT_TEXT                     (0)
+#define FORMAT_JSON                     (1)
+#define FORMAT_CSV                      (2)
+
+/* The thread data of a thread starts on its own pages */
+#define THREAD_DATA_ALIGN               (4096)
+
+/* Values of one swept option */
+#define SWEEP_MAX_VALUES                (32)
+
+#define KEY_DIST_UNIFORM                (0)
+#define KEY_DIST_ZIPF                   (1)
+#define KEY_DIST_HOTSPOT                (2)
+#define KEY_DIST_SEQUENTIAL             (3)
+#define KEY_DIST_WINDOW                 (4)
+#define KEY_DIST_N                      (5)
+
+#define LATENCY_OFF                     (0)
+#define LATENCY_PERCENTILES             (1)
+#define LATENCY_BUCKETS                 (2)
+
+/* Latency buckets: 2^LAT_SUB_BITS linear sub-buckets per power of two, so
+ * a bucket is within 1/2^LAT_SUB_BITS of its values */
+#define LAT_SUB_BITS                    (4)
+#define LAT_SUB_BUCKETS                 (1 << LAT_SUB_BITS)
+#define LAT_N_BUCKETS                   ((64 - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS)
+
+#define LAT_OP_GET                      (0)
+#define LAT_OP_PUT                      (1)
+#define LAT_OP_REMOVE                   (2)
+#define LAT_N_OPS                       (3)
+
+/* A value carries its key, so a read can check it got the right one */
+#define VALUE_MAKE(key, version)        ((((sl_value_t)(key)) << 16) | ((version) & 0xFFFF))
+#define VALUE_KEY(value)                ((sl_key_t)((value) >> 16))
+
+/* Long-only options */
+#define OPT_SPLIT_MAX_ABORTS            (256)
+#define OPT_SPLIT_MIN_LENGTH            (257)
+#define OPT_SPLIT_LEN_DELTA             (258)
+#define OPT_SPLIT_MIN_SUCCESS           (259)
+#define OPT_ZIPF_THETA                  (260)
+#define OPT_HOTSPOT                     (261)
+#define OPT_WINDOW                      (262)
+#define OPT_WINDOW_STEP                 (263)
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -44,6 +118,32 @@ static volatile long padding[50];
 
 static volatile int stop;
 
+/* Progress messages are only printed with the text format */
+static int verbose = 1;
+
+/* The key distribution of the runs, read-only while threads run */
+typedef struct key_dist {
+	int type;
+	long range;
+	
+	/* zipfian */
+	double theta;
+	double alpha;
+	double eta;
+	double zeta_n;
+	double zeta_2;
+	
+	/* hotspot: hot_ops percent of the operations use the first hot_keys keys */
+	int hot_ops;
+	long hot_keys;
+	
+	/* moving window: slides by a key every window_step draws of a thread */
+	long window;
+	long window_step;
+} key_dist_t;
+
+static key_dist_t key_dist;
+
 ///////////////////////////////////////////////////////////////////////////////
 // FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////
@@ -52,12 +152,81 @@ static inline void rand_init(int *p_seed)
 	*p_seed = rand();
 }
 
+/* Reads a "<field>: <value> kB" line of /proc/self/status */
+static long get_proc_status_kb(const char *field)
+{
+	FILE *p_file;
+	char line[256];
+	long value = -1;
+	size_t len = strlen(field);
+	
+	p_file = fopen("/proc/self/status", "r");
+	if (p_file == NULL) {
+		return -1;
+	}
+	
+	while (fgets(line, sizeof(line), p_file) != NULL) {
+		if ((strncmp(line, field, len) == 0) && (line[len] == ':')) {
+			value = atol(line + len + 1);
+			break;
+		}
+	}
+	
+	fclose(p_file);
+	return value;
+}
+
+/* Resets VmHWM to the current RSS (Linux 4.0+). Returns 0 on success. */
+static int reset_peak_rss()
+{
+	FILE *p_file;
+	int ret;
+	
+	p_file = fopen("/proc/self/clear_refs", "w");
+	if (p_file == NULL) {
+		return -1;
+	}
+	
+	ret = (fputs("5", p_file) < 0) ? -1 : 0;
+	if (fclose(p_file) != 0) {
+		ret = -1;
+	}
+	
+	return ret;
+}
+
+#define TRAVERSAL_MIN_USEC              (100000)
+
+/* Walks the bottom level until at least TRAVERSAL_MIN_USEC passed, and 
+ * returns the visited nodes per second */
+static double measure_traversal(skiplist_t *p_set)
+{
+	struct timeval start, end;
+	long n_nodes = 0;
+	long usec;
+	
+	gettimeofday(&start, NULL);
+	do {
+		n_nodes += skiplist_size(p_set) + 1;
+		gettimeofday(&end, NULL);
+		usec = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+	} while (usec < TRAVERSAL_MIN_USEC);
+	
+	return (double)n_nodes * 1000000.0 / (double)usec;
+}
+
 static inline int rand_range(int n, int *p_seed)
 {    
 	int v = MY_RAND(p_seed) % n;
 	return v;
 }
 
+typedef struct latency_histogram {
+	unsigned long n_samples;
+	unsigned long max_cycles;
+	unsigned long buckets[LAT_N_BUCKETS];
+} latency_histogram_t;
+
 typedef struct thread_data {
 	long uniq_id;
 	struct barrier *barrier;
@@ -67,26 +236,46 @@ typedef struct thread_data {
 	unsigned long nb_remove;
 	unsigned long nb_contains;
 	unsigned long nb_found;
+	unsigned long nb_value_updates;
+	unsigned long nb_bad_values;
+	unsigned long version;
 	int alg_type;
 	int max_segment_len;
 	int max_free_list;
+	int scan_mode;
+	int thread_churn;
+	int latency;
 	
 	int *p_seed;
 	int seed;
 	
+	/* key generator state */
+	uint64_t key_rng;
+	long seq_head;
+	long seq_tail;
+	long n_key_draws;
+	int n_threads;
+	
+	/* where the thread started */
+	int cpu;
+	int node;
+	
 	skiplist_t *p_set;
 	
 	int diff;
 	int range;
 	int update;
+	int value_update;
 	int alternate;
 	
 	st_thread_t *p_st;
 	st_thread_t st;
 	
+	latency_histogram_t latency_histograms[LAT_N_OPS];
+	
 	char padding[64];
 	
-} thread_data_t;
+} __attribute__((aligned(THREAD_DATA_ALIGN))) thread_data_t;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -124,50 +313,352 @@ static void barrier_cross(barrier_t *b)
   pthread_mutex_unlock(&b->mutex);
 }
 
+/////////////////////////////////////////////////////////
+// KEYS
+/////////////////////////////////////////////////////////
+static const char *key_dist_names[KEY_DIST_N] = {"uniform", "zipfian", "hotspot", "sequential", "window"};
+
+/* xorshift64*: the 64-bit draws of the skewed distributions */
+static inline uint64_t key_rand(thread_data_t *p_td)
+{
+	uint64_t x = p_td->key_rng;
+	
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	p_td->key_rng = x;
+	
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform in [0, 1) */
+static inline double key_rand_double(thread_data_t *p_td)
+{
+	return (double)(key_rand(p_td) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Precomputes the zipfian constants of Gray et al. ("Quickly generating 
+ * billion-record synthetic databases"), as YCSB does */
+static void key_dist_init(key_dist_t *p_dist, int type, long range, double theta, 
+	int hot_ops, int hot_keys, long window, long window_step)
+{
+	long i;
+	
+	memset(p_dist, 0, sizeof(key_dist_t));
+	p_dist->type = type;
+	p_dist->range = range;
+	
+	p_dist->theta = theta;
+	if (type == KEY_DIST_ZIPF) {
+		for (i = 1; i <= range; i++) {
+			p_dist->zeta_n += 1.0 / pow((double)i, theta);
+		}
+		p_dist->zeta_2 = 1.0 + 1.0 / pow(2.0, theta);
+		p_dist->alpha = 1.0 / (1.0 - theta);
+		p_dist->eta = (1.0 - pow(2.0 / (double)range, 1.0 - theta)) / (1.0 - p_dist->zeta_2 / p_dist->zeta_n);
+	}
+	
+	p_dist->hot_ops = hot_ops;
+	p_dist->hot_keys = (range * hot_keys) / 100;
+	if (p_dist->hot_keys < 1) {
+		p_dist->hot_keys = 1;
+	}
+	
+	p_dist->window = (window > 0) ? window : range / 10;
+	if (p_dist->window < 1) {
+		p_dist->window = 1;
+	}
+	p_dist->window_step = window_step;
+}
+
+/* The key of the <index>th insert of a thread in the sequential 
+ * distribution. Threads interleave, so the keys grow with time. */
+static inline sl_key_t key_seq(thread_data_t *p_td, long index)
+{
+	return (sl_key_t)(index * p_td->n_threads + p_td->uniq_id + 1);
+}
+
+/* The populated keys 1..initial are the first inserts of every thread */
+static void key_seq_init(thread_data_t *p_td)
+{
+	p_td->seq_tail = 0;
+	p_td->seq_head = (p_td->uniq_id < p_td->initial) ? 
+		(p_td->initial - p_td->uniq_id + p_td->n_threads - 1) / p_td->n_threads : 0;
+}
+
+/* A key to read or update */
+static inline sl_key_t key_next(thread_data_t *p_td)
+{
+	key_dist_t *p_dist = &key_dist;
+	uint64_t rank;
+	double u, uz;
+	long base;
+	
+	switch (p_dist->type) {
+		case KEY_DIST_ZIPF:
+			u = key_rand_double(p_td);
+			uz = u * p_dist->zeta_n;
+			if (uz < 1.0) {
+				rank = 0;
+			} else if (uz < 1.0 + pow(0.5, p_dist->theta)) {
+				rank = 1;
+			} else {
+				rank = (uint64_t)((double)p_dist->range * pow(p_dist->eta * u - p_dist->eta + 1.0, p_dist->alpha));
+				if (rank >= (uint64_t)p_dist->range) {
+					rank = p_dist->range - 1;
+				}
+			}
+			/* A prime larger than the range permutes the ranks, so that 
+			 * the hot keys are not neighbours */
+			return (sl_key_t)((rank * 2654435761ULL) % p_dist->range) + 1;
+			
+		case KEY_DIST_HOTSPOT:
+			if ((int)(key_rand(p_td) % 100) < p_dist->hot_ops) {
+				return (sl_key_t)(key_rand(p_td) % p_dist->hot_keys) + 1;
+			}
+			if (p_dist->hot_keys >= p_dist->range) {
+				return (sl_key_t)(key_rand(p_td) % p_dist->range) + 1;
+			}
+			return (sl_key_t)(p_dist->hot_keys + (key_rand(p_td) % (p_dist->range - p_dist->hot_keys))) + 1;
+			
+		case KEY_DIST_SEQUENTIAL:
+			if (p_td->seq_head == p_td->seq_tail) {
+				return key_seq(p_td, p_td->seq_tail);
+			}
+			return key_seq(p_td, p_td->seq_tail + (long)(key_rand(p_td) % (p_td->seq_head - p_td->seq_tail)));
+			
+		case KEY_DIST_WINDOW:
+			base = (p_td->n_key_draws++ / p_dist->window_step) % p_dist->range;
+			return (sl_key_t)((base + (long)(key_rand(p_td) % p_dist->window)) % p_dist->range) + 1;
+			
+		default:
+			return rand_range(p_td->range, p_td->p_seed) + 1;
+	}
+}
+
+/* A key to insert: the next of the thread in the sequential distribution */
+static inline sl_key_t key_insert(thread_data_t *p_td)
+{
+	if (key_dist.type == KEY_DIST_SEQUENTIAL) {
+		return key_seq(p_td, p_td->seq_head++);
+	}
+	
+	return key_next(p_td);
+}
+
+/* A key to remove: the oldest of the thread in the sequential distribution */
+static inline sl_key_t key_remove(thread_data_t *p_td)
+{
+	if (key_dist.type == KEY_DIST_SEQUENTIAL) {
+		if (p_td->seq_tail == p_td->seq_head) {
+			/* nothing inserted yet, so the remove misses */
+			return key_seq(p_td, p_td->seq_tail);
+		}
+		return key_seq(p_td, p_td->seq_tail++);
+	}
+	
+	return key_next(p_td);
+}
+
+/////////////////////////////////////////////////////////
+// LATENCY
+/////////////////////////////////////////////////////////
+static const char *latency_op_names[LAT_N_OPS] = {"get", "put", "remove"};
+
+static inline int latency_bucket(unsigned long cycles)
+{
+	int exp;
+	
+	if (cycles < LAT_SUB_BUCKETS) {
+		return (int)cycles;
+	}
+	
+	exp = 63 - __builtin_clzl(cycles);
+	return ((exp - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS) + (int)((cycles >> (exp - LAT_SUB_BITS)) & (LAT_SUB_BUCKETS - 1));
+}
+
+/* The smallest value of a bucket */
+static unsigned long latency_bucket_low(int bucket)
+{
+	int shift = (bucket / LAT_SUB_BUCKETS) - 1;
+	
+	if (shift < 0) {
+		return (unsigned long)bucket;
+	}
+	
+	return ((unsigned long)(LAT_SUB_BUCKETS + (bucket % LAT_SUB_BUCKETS))) << shift;
+}
+
+/* The largest value of a bucket */
+static unsigned long latency_bucket_high(int bucket)
+{
+	if (bucket == LAT_N_BUCKETS - 1) {
+		return ~0UL;
+	}
+	
+	return latency_bucket_low(bucket + 1) - 1;
+}
+
+static inline unsigned long latency_start(thread_data_t *p_td)
+{
+	return p_td->latency ? __rdtsc() : 0;
+}
+
+static inline void latency_end(thread_data_t *p_td, int op, unsigned long start_cycles)
+{
+	latency_histogram_t *p_hist;
+	unsigned long cycles;
+	
+	if (!p_td->latency) {
+		return;
+	}
+	
+	cycles = __rdtsc() - start_cycles;
+	p_hist = &(p_td->latency_histograms[op]);
+	
+	p_hist->n_samples++;
+	p_hist->buckets[latency_bucket(cycles)]++;
+	if (cycles > p_hist->max_cycles) {
+		p_hist->max_cycles = cycles;
+	}
+}
+
+static void latency_merge(latency_histogram_t *p_dst, latency_histogram_t *p_src)
+{
+	int i;
+	
+	p_dst->n_samples += p_src->n_samples;
+	if (p_src->max_cycles > p_dst->max_cycles) {
+		p_dst->max_cycles = p_src->max_cycles;
+	}
+	for (i = 0; i < LAT_N_BUCKETS; i++) {
+		p_dst->buckets[i] += p_src->buckets[i];
+	}
+}
+
+/* The largest value of the bucket that holds the percentile, capped by 
+ * the exact maximum */
+static unsigned long latency_percentile(latency_histogram_t *p_hist, double percentile)
+{
+	int i;
+	unsigned long rank;
+	unsigned long count = 0;
+	unsigned long high;
+	
+	if (p_hist->n_samples == 0) {
+		return 0;
+	}
+	
+	rank = (unsigned long)((percentile / 100.0) * (double)p_hist->n_samples);
+	if (rank >= p_hist->n_samples) {
+		rank = p_hist->n_samples - 1;
+	}
+	
+	for (i = 0; i < LAT_N_BUCKETS; i++) {
+		count += p_hist->buckets[i];
+		if (count > rank) {
+			break;
+		}
+	}
+	
+	high = latency_bucket_high(i);
+	return (high < p_hist->max_cycles) ? high : p_hist->max_cycles;
+}
+
+static void latency_print(latency_histogram_t *p_hists, int latency, double cycles_per_ns)
+{
+	int op, i;
+	latency_histogram_t *p_hist;
+	
+	printf("Latency        : ns (%.3f cycles / ns)\n", cycles_per_ns);
+	for (op = 0; op < LAT_N_OPS; op++) {
+		p_hist = &(p_hists[op]);
+		if (p_hist->n_samples == 0) {
+			continue;
+		}
+		printf("  %-12s : n %lu, p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max %.0f\n",
+			latency_op_names[op], p_hist->n_samples,
+			latency_percentile(p_hist, 50.0) / cycles_per_ns,
+			latency_percentile(p_hist, 90.0) / cycles_per_ns,
+			latency_percentile(p_hist, 99.0) / cycles_per_ns,
+			latency_percentile(p_hist, 99.9) / cycles_per_ns,
+			p_hist->max_cycles / cycles_per_ns);
+	}
+	
+	if (latency != LATENCY_BUCKETS) {
+		return;
+	}
+	
+	/* Raw buckets in cycles: op, low, high, count */
+	for (op = 0; op < LAT_N_OPS; op++) {
+		p_hist = &(p_hists[op]);
+		for (i = 0; i < LAT_N_BUCKETS; i++) {
+			if (p_hist->buckets[i] > 0) {
+				printf("  bucket       : %s %lu %lu %lu\n", latency_op_names[op], 
+					latency_bucket_low(i), latency_bucket_high(i), p_hist->buckets[i]);
+			}
+		}
+	}
+}
+
 /////////////////////////////////////////////////////////
 // SKIP-LIST
 /////////////////////////////////////////////////////////
-int set_contains(thread_data_t *p_td, int key) {
+int set_get(thread_data_t *p_td, sl_key_t key, sl_value_t *p_value) {
 	int res;
 
 	if (p_td->alg_type == ALG_TYPE_PURE) {
-		res = skiplist_contains_pure(p_td->p_st, p_td->p_set, key);
+		res = skiplist_get_pure(p_td->p_st, p_td->p_set, key, p_value);
 	} else if (p_td->alg_type == ALG_TYPE_HAZARD_POINTERS) {
-		res = skiplist_contains_hp(p_td->p_st, p_td->p_set, key);
+		res = skiplist_get_hp(p_td->p_st, p_td->p_set, key, p_value);
 	} else if (p_td->alg_type == ALG_TYPE_STACK_TRACK) {
-		res = skiplist_contains_stacktrack(p_td->p_st, p_td->p_set, key);
+		res = skiplist_get_stacktrack(p_td->p_st, p_td->p_set, key, p_value);
+	} else if (p_td->alg_type == ALG_TYPE_EBR) {
+		res = skiplist_get_ebr(p_td->p_st, p_td->p_set, key, p_value);
+	} else if (p_td->alg_type == ALG_TYPE_IBR) {
+		res = skiplist_get_ibr(p_td->p_st, p_td->p_set, key, p_value);
 	}
 	
 	return res;
 }
 
-int set_add(thread_data_t *p_td, int key) {
-	volatile sl_node_t *p_node;
+int set_put(thread_data_t *p_td, sl_key_t key) {
+	int res;
+	sl_value_t value = VALUE_MAKE(key, ++p_td->version);
 	
 	if (p_td->alg_type == ALG_TYPE_PURE) {
-		p_node = skiplist_insert_pure(p_td->p_st, p_td->p_set, key);
+		res = skiplist_put_pure(p_td->p_st, p_td->p_set, key, value, NULL);
 	} else if (p_td->alg_type == ALG_TYPE_HAZARD_POINTERS) {
-		p_node = skiplist_insert_hp(p_td->p_st, p_td->p_set, key);
+		res = skiplist_put_hp(p_td->p_st, p_td->p_set, key, value, NULL);
 	} else if (p_td->alg_type == ALG_TYPE_STACK_TRACK) {
-		p_node = skiplist_insert_stacktrack(p_td->p_st, p_td->p_set, key);
+		res = skiplist_put_stacktrack(p_td->p_st, p_td->p_set, key, value, NULL);
+	} else if (p_td->alg_type == ALG_TYPE_EBR) {
+		res = skiplist_put_ebr(p_td->p_st, p_td->p_set, key, value, NULL);
+	} else if (p_td->alg_type == ALG_TYPE_IBR) {
+		res = skiplist_put_ibr(p_td->p_st, p_td->p_set, key, value, NULL);
 	}
 	
-	if (p_node != NULL) {
-		return 1;
-	} 
-	
-	return 0;	
+	return res;	
 }
 
-int set_remove(thread_data_t *p_td, int key) {
+int set_remove(thread_data_t *p_td, sl_key_t key) {
 	int res;
+	sl_value_t value;
 
 	if (p_td->alg_type == ALG_TYPE_PURE) {
-		res = skiplist_remove_pure(p_td->p_st, p_td->p_set, key);
+		res = skiplist_remove_pure(p_td->p_st, p_td->p_set, key, &value);
 	} else if (p_td->alg_type == ALG_TYPE_HAZARD_POINTERS) {
-		res = skiplist_remove_hp(p_td->p_st, p_td->p_set, key);
+		res = skiplist_remove_hp(p_td->p_st, p_td->p_set, key, &value);
 	} else if (p_td->alg_type == ALG_TYPE_STACK_TRACK) {
-		res = skiplist_remove_stacktrack(p_td->p_st, p_td->p_set, key);
+		res = skiplist_remove_stacktrack(p_td->p_st, p_td->p_set, key, &value);
+	} else if (p_td->alg_type == ALG_TYPE_EBR) {
+		res = skiplist_remove_ebr(p_td->p_st, p_td->p_set, key, &value);
+	} else if (p_td->alg_type == ALG_TYPE_IBR) {
+		res = skiplist_remove_ibr(p_td->p_st, p_td->p_set, key, &value);
+	}
+	
+	if (res && (VALUE_KEY(value) != key)) {
+		p_td->nb_bad_values++;
 	}
 	
 	return res;
@@ -180,72 +671,127 @@ static void *test(void *p_arg)
 {
 	int i;
 	int op;
-	int key;
-	int last = -1;
+	sl_key_t key;
+	sl_key_t last = 0;
+	sl_value_t value;
+	int res;
+	unsigned long start_cycles;
+	long n_ops_since_init = 0;
 	thread_data_t *p_td = (thread_data_t *)p_arg;
 
-	ST_thread_init(p_td->p_st, p_td->p_seed, p_td->max_segment_len, p_td->max_free_list);
+	PLACEMENT_current(&(p_td->cpu), &(p_td->node));
+	
+	ST_thread_init(p_td->p_st, p_td->p_seed, p_td->max_segment_len, p_td->max_free_list, p_td->scan_mode);
 
 	if (p_td->p_st->uniq_id == 0) {
 		/* Populate set */
-		printf("[%ld] Init: adding %d entries to set.\n", p_td->uniq_id, p_td->initial);
+		if (verbose) {
+			printf("[%ld] Init: adding %d entries to set.\n", p_td->uniq_id, p_td->initial);
+		}
 		i = 0;
 		while (i < p_td->initial) {
-			key = rand_range(p_td->range, p_td->p_seed) + 1;
-			if (set_add(p_td, key)) {
+			if (key_dist.type == KEY_DIST_SEQUENTIAL) {
+				key = i + 1;
+			} else {
+				key = rand_range(p_td->range, p_td->p_seed) + 1;
+			}
+			if (set_put(p_td, key)) {
 				i++;
 			}
 		}
-		printf("[%ld] Init: done.\n", p_td->uniq_id);
+		if (verbose) {
+			printf("[%ld] Init: done.\n", p_td->uniq_id);
+		}
 	}
 	
+	key_seq_init(p_td);
+	
 	/* Wait on barrier */
 	barrier_cross(p_td->barrier);
 
 	while (stop == 0) {
 		
+		if ((p_td->thread_churn > 0) && (++n_ops_since_init >= p_td->thread_churn)) {
+			/* Deregister and register again, as an exiting worker would */
+			ST_thread_finish(p_td->p_st);
+			ST_thread_init(p_td->p_st, p_td->p_seed, p_td->max_segment_len, p_td->max_free_list, p_td->scan_mode);
+			n_ops_since_init = 0;
+		}
+		
 		op = rand_range(100, p_td->p_seed);
 		
 		if (op < p_td->update) {
 			if (p_td->alternate) {
 				/* Alternate insertions and removals */
-				if (last < 0) {
+				if (last == 0) {
 					/* Add random value */
-					key = rand_range(p_td->range, p_td->p_seed) + 1;
-					if (set_add(p_td, key)) {
+					key = key_insert(p_td);
+					start_cycles = latency_start(p_td);
+					res = set_put(p_td, key);
+					latency_end(p_td, LAT_OP_PUT, start_cycles);
+					if (res) {
 						p_td->diff++;
 						last = key;
 					}
 					p_td->nb_add++;
 				} else {
-					/* Remove last value */
-					if (set_remove(p_td, last)) {
+					/* Remove last value, or the oldest one of a sequence */
+					if (key_dist.type == KEY_DIST_SEQUENTIAL) {
+						last = key_remove(p_td);
+					}
+					start_cycles = latency_start(p_td);
+					res = set_remove(p_td, last);
+					latency_end(p_td, LAT_OP_REMOVE, start_cycles);
+					if (res) {
 						p_td->diff--;
 					}
 					p_td->nb_remove++;
-					last = -1;
+					last = 0;
 				}
 			} else {
 				/* Randomly perform insertions and removals */
-				key = rand_range(p_td->range, p_td->p_seed) + 1;
 				if ((op & 0x01) == 0) {
 					/* Add random value */
-					if (set_add(p_td, key)) {
+					key = key_insert(p_td);
+					start_cycles = latency_start(p_td);
+					res = set_put(p_td, key);
+					latency_end(p_td, LAT_OP_PUT, start_cycles);
+					if (res) {
 						p_td->diff++;
 					}
 					p_td->nb_add++;
 				} else {
 					/* Remove random value */
-					if (set_remove(p_td, key)) {
+					key = key_remove(p_td);
+					start_cycles = latency_start(p_td);
+					res = set_remove(p_td, key);
+					latency_end(p_td, LAT_OP_REMOVE, start_cycles);
+					if (res) {
 						p_td->diff--;
 					}
 					p_td->nb_remove++;
 				}
 			}
+		} else if (op < p_td->update + p_td->value_update) {
+			/* Replace the value of a random present key */
+			key = key_next(p_td);
+			if (set_get(p_td, key, NULL)) {
+				if (set_put(p_td, key)) {
+					/* removed meanwhile, so put inserted it */
+					p_td->diff++;
+				}
+			}
+			p_td->nb_value_updates++;
 		} else {
 			/* Look for random value */
-			key = rand_range(p_td->range, p_td->p_seed) + 1;
-			if (set_contains(p_td, key)) {
+			key = key_next(p_td);
+			start_cycles = latency_start(p_td);
+			res = set_get(p_td, key, &value);
+			latency_end(p_td, LAT_OP_GET, start_cycles);
+			if (res) {
+				if (VALUE_KEY(value) != key) {
+					p_td->nb_bad_values++;
+				}
 				p_td->nb_found++;
 			}
 			p_td->nb_contains++;
@@ -257,54 +803,958 @@ static void *test(void *p_arg)
 	return NULL;
 }
 
-int main(int argc, char **argv)
-{
-	struct option long_options[] = {
-			// These options don't set a flag
-			{"help",                      no_argument,       NULL, 'h'},
-			{"do-not-alternate",          no_argument,       NULL, 'a'},
-			{"duration",                  required_argument, NULL, 'd'},
-			{"initial-size",              required_argument, NULL, 'i'},
-			{"num-threads",               required_argument, NULL, 'n'},
-			{"range",                     required_argument, NULL, 'r'},
-			{"seed",                      required_argument, NULL, 's'},
-			{"update-rate",               required_argument, NULL, 'u'},
-			{"max-segment-length",        required_argument, NULL, 'l'},
-			{"free-batch-size",           required_argument, NULL, 'f'},
-			{"alg_type",                  required_argument, NULL, 'p'},
-			{NULL, 0, NULL, 0}
-	};
+/////////////////////////////////////////////////////////
+// RUNS
+/////////////////////////////////////////////////////////
+
+/* The parameters of one run. A sweep varies the protocol, the threads, the
+ * update rate, the segment length and the free batch; the rest is shared. */
+typedef struct bench_config {
+	int alg_type;
+	int nb_threads;
+	int update;
+	int max_segment_len;
+	int max_free_list;
+	int repetition;
+	
+	int value_update;
+	int duration;
+	int initial;
+	int range;
+	int alternate;
+	int scan_mode;
+	int scan_kernel;
+	int thread_churn;
+	int n_reclaimers;
+	int allocator;
+	int prealloc;
+	int htm_backend;
+	int warm_start;
+	int latency;
+	int placement;
+	int mem_interval;
+	int interval;
+} bench_config_t;
+
+/* A memory sample of the run */
+typedef struct mem_sample {
+	int t_ms;
+	long rss_kb;
+	long unreclaimed;
+} mem_sample_t;
+
+/* The operations and reclamation events of all the workers in an interval */
+typedef struct interval_sample {
+	int t_ms;
+	int length_ms;
+	unsigned long ops;
+	long slow_path_segments;
+	long stack_scans;
+	long splits;
+	long split_length;
+} interval_sample_t;
 
+/* The counters of a worker at the last sample */
+typedef struct interval_counters {
+	unsigned long ops;
+	long slow_path_segments;
+	long stack_scans;
+	long splits;
+	long split_length;
+} interval_counters_t;
+
+typedef struct bench_result {
 	skiplist_t *p_set;
-	int i, c, val, cur_size, size, ret;
-	unsigned long reads, updates;
 	thread_data_t *data;
-	pthread_t *threads;
-	pthread_attr_t attr;
-	barrier_t barrier;
-	struct timeval start, end;
+	int duration;
+	int size;
+	int expected_size;
+	unsigned long reads;
+	unsigned long updates;
+	unsigned long bad_values;
+	double ops_per_sec;
+	/* the RSS before the set was created, and the peak of this run only */
+	long base_rss_kb;
+	long rss_kb;
+	long peak_rss_kb;
+	int is_peak_rss_reset;
+	double node_bytes;
+	double traversal;
+	double cycles_per_ns;
+	long unreclaimed;
+	/* the samples, and the per-thread unreclaimed nodes of every sample */
+	mem_sample_t *p_samples;
+	long *p_thread_samples;
+	int n_samples;
+	double rss_avg_kb;
+	long rss_sampled_peak_kb;
+	double unreclaimed_avg;
+	long unreclaimed_sampled_peak;
+	interval_sample_t *p_intervals;
+	int n_intervals;
+	latency_histogram_t latency[LAT_N_OPS];
+	htm_stats_t htm;
+	st_stats_t st;
+} bench_result_t;
+
+static const char *alg_type_name(int alg_type)
+{
+	switch (alg_type) {
+		case ALG_TYPE_PURE: return "pure";
+		case ALG_TYPE_HAZARD_POINTERS: return "hazard pointers";
+		case ALG_TYPE_STACK_TRACK: return "stack-track";
+		case ALG_TYPE_EBR: return "ebr";
+		case ALG_TYPE_IBR: return "ibr";
+		default: return "unknown";
+	}
+}
+
+static void sleep_ms(int ms)
+{
 	struct timespec timeout;
-	int alg_type = DEFAULT_ALG_TYPE;
-	int max_segment_len = DEFAULT_MAX_SEGMENT_LEN;
-	int max_free_list = DEFAULT_MAX_FREE_LIST;
-	int duration = DEFAULT_DURATION;
-	int initial = DEFAULT_INITIAL;
-	int nb_threads = DEFAULT_NB_THREADS;
-	int range = DEFAULT_RANGE;
-	int seed = DEFAULT_SEED;
-	int update = DEFAULT_UPDATE;
-	int alternate = 1;
-	sigset_t block_set;
+	
+	timeout.tv_sec = ms / 1000;
+	timeout.tv_nsec = (ms % 1000) * 1000000;
+	nanosleep(&timeout, NULL);
+}
 
-	while(1) {
-		i = 0;
-		c = getopt_long(argc, argv, "had:i:n:r:s:u:l:f:p:", long_options, &i);
+static int elapsed_ms(struct timeval *p_start)
+{
+	struct timeval now;
+	
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - p_start->tv_sec) * 1000 + (now.tv_usec - p_start->tv_usec) / 1000;
+}
 
-		if(c == -1)
+/* Samples the RSS and the unreclaimed nodes every mem_interval ms, until 
+ * the duration passed */
+static void sample_memory(bench_config_t *p_cfg, bench_result_t *p_res, thread_data_t *data, struct timeval *p_start)
+{
+	int i;
+	int t_ms;
+	int max_samples = p_cfg->duration / p_cfg->mem_interval + 1;
+	mem_sample_t *p_sample;
+	
+	p_res->p_samples = (mem_sample_t *)malloc(max_samples * sizeof(mem_sample_t));
+	p_res->p_thread_samples = (long *)malloc(max_samples * p_cfg->nb_threads * sizeof(long));
+	if ((p_res->p_samples == NULL) || (p_res->p_thread_samples == NULL)) {
+		perror("malloc");
+		exit(1);
+	}
+	
+	while (1) {
+		t_ms = elapsed_ms(p_start);
+		if ((t_ms >= p_cfg->duration) || (p_res->n_samples == max_samples)) {
 			break;
+		}
+		
+		p_sample = &(p_res->p_samples[p_res->n_samples]);
+		p_sample->t_ms = t_ms;
+		p_sample->rss_kb = get_proc_status_kb("VmRSS");
+		p_sample->unreclaimed = ST_unreclaimed();
+		for (i = 0; i < p_cfg->nb_threads; i++) {
+			p_res->p_thread_samples[p_res->n_samples * p_cfg->nb_threads + i] = ST_thread_unreclaimed(data[i].p_st);
+		}
+		
+		p_res->rss_avg_kb += p_sample->rss_kb;
+		p_res->unreclaimed_avg += p_sample->unreclaimed;
+		if (p_sample->rss_kb > p_res->rss_sampled_peak_kb) {
+			p_res->rss_sampled_peak_kb = p_sample->rss_kb;
+		}
+		if (p_sample->unreclaimed > p_res->unreclaimed_sampled_peak) {
+			p_res->unreclaimed_sampled_peak = p_sample->unreclaimed;
+		}
+		p_res->n_samples++;
+		
+		t_ms = (p_res->n_samples * p_cfg->mem_interval < p_cfg->duration) ? 
+			p_res->n_samples * p_cfg->mem_interval : p_cfg->duration;
+		t_ms -= elapsed_ms(p_start);
+		if (t_ms > 0) {
+			sleep_ms(t_ms);
+		}
+	}
+	
+	if (p_res->n_samples > 0) {
+		p_res->rss_avg_kb /= p_res->n_samples;
+		p_res->unreclaimed_avg /= p_res->n_samples;
+	}
+	
+	t_ms = p_cfg->duration - elapsed_ms(p_start);
+	if (t_ms > 0) {
+		sleep_ms(t_ms);
+	}
+}
 
-		if(c == 0 && long_options[i].flag == 0)
-			c = long_options[i].val;
+typedef struct interval_sampler {
+	bench_config_t *p_cfg;
+	bench_result_t *p_res;
+	thread_data_t *data;
+	struct timeval start;
+} interval_sampler_t;
+
+/* A counter that went back was reset by a re-registration (thread churn) */
+static inline long interval_delta(long cur, long *p_last)
+{
+	long delta = (cur >= *p_last) ? (cur - *p_last) : cur;
+	
+	*p_last = cur;
+	return delta;
+}
+
+/* Reads the plain counters of the workers every interval ms, until the run 
+ * stops. The last partial interval is dropped. */
+static void *interval_sampler_run(void *p_arg)
+{
+	int i;
+	int t_ms;
+	int last_ms = 0;
+	int max_intervals;
+	long ops;
+	interval_sampler_t *p_sampler = (interval_sampler_t *)p_arg;
+	bench_config_t *p_cfg = p_sampler->p_cfg;
+	bench_result_t *p_res = p_sampler->p_res;
+	volatile thread_data_t *p_td;
+	volatile st_thread_stats_t *p_stats;
+	interval_counters_t *p_last;
+	interval_sample_t *p_sample;
+	
+	max_intervals = p_cfg->duration / p_cfg->interval + 1;
+	p_res->p_intervals = (interval_sample_t *)malloc(max_intervals * sizeof(interval_sample_t));
+	p_last = (interval_counters_t *)calloc(p_cfg->nb_threads, sizeof(interval_counters_t));
+	if ((p_res->p_intervals == NULL) || (p_last == NULL)) {
+		perror("malloc");
+		exit(1);
+	}
+	
+	while (p_res->n_intervals < max_intervals) {
+		t_ms = (p_res->n_intervals + 1) * p_cfg->interval - elapsed_ms(&(p_sampler->start));
+		if (t_ms > 0) {
+			sleep_ms(t_ms);
+		}
+		if (stop) {
+			break;
+		}
+		
+		p_sample = &(p_res->p_intervals[p_res->n_intervals]);
+		memset(p_sample, 0, sizeof(interval_sample_t));
+		
+		t_ms = elapsed_ms(&(p_sampler->start));
+		p_sample->t_ms = t_ms;
+		p_sample->length_ms = t_ms - last_ms;
+		last_ms = t_ms;
+		
+		for (i = 0; i < p_cfg->nb_threads; i++) {
+			p_td = &(p_sampler->data[i]);
+			p_stats = &(p_td->st.stats);
+			
+			ops = p_td->nb_add + p_td->nb_remove + p_td->nb_contains + p_td->nb_value_updates;
+			p_sample->ops += ops - p_last[i].ops;
+			p_last[i].ops = ops;
+			
+			p_sample->slow_path_segments += interval_delta(p_stats->n_slow_path_segments, &(p_last[i].slow_path_segments));
+			p_sample->stack_scans += interval_delta(p_stats->n_stack_scans, &(p_last[i].stack_scans));
+			p_sample->splits += interval_delta(p_stats->n_splits, &(p_last[i].splits));
+			p_sample->split_length += interval_delta(p_stats->n_split_length, &(p_last[i].split_length));
+		}
+		
+		p_res->n_intervals++;
+	}
+	
+	free(p_last);
+	
+	return NULL;
+}
+
+static double interval_ops_per_sec(interval_sample_t *p_sample)
+{
+	return p_sample->length_ms ? p_sample->ops * 1000.0 / p_sample->length_ms : 0.0;
+}
+
+static void interval_range(bench_result_t *p_res, double *p_min, double *p_max)
+{
+	int i;
+	double ops_per_sec;
+	
+	*p_min = 0.0;
+	*p_max = 0.0;
+	for (i = 0; i < p_res->n_intervals; i++) {
+		ops_per_sec = interval_ops_per_sec(&(p_res->p_intervals[i]));
+		if ((i == 0) || (ops_per_sec < *p_min)) {
+			*p_min = ops_per_sec;
+		}
+		if (ops_per_sec > *p_max) {
+			*p_max = ops_per_sec;
+		}
+	}
+}
+
+/* Runs the threads on a new set. The caller frees the set with free_set after the report. */
+static void run_bench(bench_config_t *p_cfg, bench_result_t *p_res)
+{
+	int i, c;
+	thread_data_t *data;
+	const placement_cpu_t *p_cpu;
+	pthread_t *threads;
+	pthread_t sampler_thread;
+	interval_sampler_t sampler;
+	pthread_attr_t attr;
+	barrier_t barrier;
+	struct timeval start, end;
+	unsigned long start_cycles, end_cycles;
+	struct timespec timeout;
+	sigset_t block_set;
+	int nb_threads = p_cfg->nb_threads;
+
+	memset(p_res, 0, sizeof(bench_result_t));
+	
+	/* Every run starts from empty stats and an empty segment model */
+	HTM_reset_stats();
+	ST_reset_stats();
+	ST_model_init(p_cfg->warm_start);
+
+	timeout.tv_sec = p_cfg->duration / 1000;
+	timeout.tv_nsec = (p_cfg->duration % 1000) * 1000000;
+
+	/* The pages of the thread data are first touched on the cpu of their 
+	 * thread, so the kernel puts them on its node */
+	data = (thread_data_t *)mmap(NULL, nb_threads * sizeof(thread_data_t), PROT_READ | PROT_WRITE, 
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	
+	for (i = 0; i < nb_threads; i++) {
+		if ((p_cpu = PLACEMENT_of(i)) != NULL) {
+			PLACEMENT_bind(p_cpu->cpu);
+		}
+		memset(&(data[i]), 0, sizeof(thread_data_t));
+	}
+	if (p_cfg->placement != PLACEMENT_NONE) {
+		PLACEMENT_unbind();
+	}
+
+	if ((threads = (pthread_t *)malloc(nb_threads * sizeof(pthread_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+
+	p_res->is_peak_rss_reset = (reset_peak_rss() == 0);
+	p_res->base_rss_kb = get_proc_status_kb("VmRSS");
+	p_res->p_set = skiplist_init((p_cfg->initial > (p_cfg->range / 2)) ? p_cfg->initial : (p_cfg->range / 2));
+	
+	stop = 0;
+
+	if (verbose) {
+		printf("Set type           : skip-list [** %s **]\n", alg_type_name(p_cfg->alg_type));
+		printf("Set size           : %d\n", p_cfg->initial);
+		printf("Max level          : %d\n", p_res->p_set->max_level);
+	}
+	
+	/* Access set from all threads */
+	barrier_init(&barrier, nb_threads + 1);
+	for (i = 0; i < nb_threads; i++) {
+		if (verbose) {
+			printf("Creating thread %d\n", i);
+		}
+		
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		if ((p_cpu = PLACEMENT_of(i)) != NULL) {
+			PLACEMENT_attr_set(&attr, p_cpu->cpu);
+		}
+
+		data[i].uniq_id = i;
+		data[i].range = p_cfg->range;
+		data[i].update = p_cfg->update;
+		data[i].value_update = p_cfg->value_update;
+		data[i].alternate = p_cfg->alternate;
+		data[i].nb_add = 0;
+		data[i].nb_remove = 0;
+		data[i].nb_contains = 0;
+		data[i].nb_found = 0;
+		data[i].diff = 0;
+		data[i].p_seed = &(data[i].seed);
+		rand_init(data[i].p_seed);
+		data[i].key_rng = ((uint64_t)rand() << 32) | (uint64_t)rand() | 1;
+		data[i].n_threads = nb_threads;
+		data[i].p_set = p_res->p_set;
+		data[i].barrier = &barrier;
+		data[i].initial = p_cfg->initial;
+		data[i].alg_type = p_cfg->alg_type;
+		data[i].max_segment_len = p_cfg->max_segment_len;
+		data[i].max_free_list = p_cfg->max_free_list;
+		data[i].scan_mode = p_cfg->scan_mode;
+		data[i].thread_churn = p_cfg->thread_churn;
+		data[i].latency = p_cfg->latency;
+		data[i].p_st = &(data[i].st);  
+
+		if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
+			fprintf(stderr, "Error creating thread\n");
+			exit(1);
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	/* Start threads */
+	barrier_cross(&barrier);
+	
+	/* Reclaimers start after the workers are registered, so that worker 0 populated the set.
+	 * EBR and IBR free by epochs and eras, and their threads are invisible to the stack scans 
+	 * of a reclaimer. */
+	ST_reclaimers_start(((p_cfg->alg_type == ALG_TYPE_EBR) || (p_cfg->alg_type == ALG_TYPE_IBR)) ? 0 : p_cfg->n_reclaimers, 
+		p_cfg->scan_mode);
+
+	if (verbose) {
+		printf("STARTING...\n");
+	}
+	gettimeofday(&start, NULL);
+	start_cycles = __rdtsc();
+	if (p_cfg->interval > 0) {
+		sampler.p_cfg = p_cfg;
+		sampler.p_res = p_res;
+		sampler.data = data;
+		sampler.start = start;
+		if (pthread_create(&sampler_thread, NULL, interval_sampler_run, &sampler) != 0) {
+			fprintf(stderr, "Error creating the sampler thread\n");
+			exit(1);
+		}
+	}
+	if ((p_cfg->duration > 0) && (p_cfg->mem_interval > 0)) {
+		sample_memory(p_cfg, p_res, data, &start);
+	} else if (p_cfg->duration > 0) {
+		nanosleep(&timeout, NULL);
+	} else {
+		sigemptyset(&block_set);
+		sigsuspend(&block_set);
+	}
+	stop = 1;
+	gettimeofday(&end, NULL);
+	end_cycles = __rdtsc();
+	if (verbose) {
+		printf("STOPPING...\n");
+	}
+
+	if ((p_cfg->interval > 0) && (pthread_join(sampler_thread, NULL) != 0)) {
+		fprintf(stderr, "Error waiting for the sampler thread\n");
+		exit(1);
+	}
+	
+	/* Wait for thread completion */
+	for (i = 0; i < nb_threads; i++) {
+		if (pthread_join(threads[i], NULL) != 0) {
+			fprintf(stderr, "Error waiting for thread completion\n");
+			exit(1);
+		}
+	}
+	
+	ST_reclaimers_stop();
+
+	p_res->data = data;
+	p_res->duration = (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
+	p_res->expected_size = p_cfg->initial;
+	for (i = 0; i < nb_threads; i++) {
+		p_res->reads += data[i].nb_contains;
+		p_res->updates += (data[i].nb_add + data[i].nb_remove + data[i].nb_value_updates);
+		p_res->bad_values += data[i].nb_bad_values;
+		p_res->expected_size += data[i].diff;
+		for (c = 0; c < LAT_N_OPS; c++) {
+			latency_merge(&(p_res->latency[c]), &(data[i].latency_histograms[c]));
+		}
+	}
+	p_res->size = skiplist_size(p_res->p_set);
+	p_res->ops_per_sec = p_res->duration ? (p_res->reads + p_res->updates) * 1000.0 / p_res->duration : 0.0;
+	p_res->rss_kb = get_proc_status_kb("VmRSS");
+	/* Without a VmHWM reset, the peak of the run is the highest RSS it saw */
+	if (p_res->is_peak_rss_reset) {
+		p_res->peak_rss_kb = get_proc_status_kb("VmHWM");
+	} else {
+		p_res->peak_rss_kb = (p_res->rss_sampled_peak_kb > p_res->rss_kb) ? p_res->rss_sampled_peak_kb : p_res->rss_kb;
+	}
+	p_res->unreclaimed = ST_unreclaimed();
+	p_res->node_bytes = p_res->size ? (double)skiplist_node_bytes(p_res->p_set) / (double)p_res->size : 0.0;
+	p_res->traversal = measure_traversal(p_res->p_set);
+	/* The run calibrates the TSC rate */
+	p_res->cycles_per_ns = p_res->duration ? (double)(end_cycles - start_cycles) / ((double)p_res->duration * 1000000.0) : 0.0;
+	
+	HTM_get_stats(&(p_res->htm));
+	ST_get_stats(&(p_res->st));
+
+	free(threads);
+}
+
+/* Frees the set of a run with a short-lived stack-track thread, which owns
+ * a pool like the workers did. After the last worker the orphaned nodes are
+ * freed too, and the free heap goes back to the kernel, so the next run 
+ * starts from about the same RSS. */
+static void free_set(bench_config_t *p_cfg, bench_result_t *p_res)
+{
+	st_thread_t *p_st;
+	int seed = 0;
+	
+	if ((p_st = (st_thread_t *)malloc(sizeof(st_thread_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	
+	ST_thread_init(p_st, &seed, p_cfg->max_segment_len, p_cfg->max_free_list, p_cfg->scan_mode);
+	skiplist_destroy(p_st, p_res->p_set);
+	ST_thread_finish(p_st);
+	
+	free(p_st);
+	p_res->p_set = NULL;
+	
+	malloc_trim(0);
+}
+
+static void print_run_text(bench_config_t *p_cfg, bench_result_t *p_res)
+{
+	int i, c;
+	double min_ops, max_ops;
+	interval_sample_t *p_interval;
+	thread_data_t *data = p_res->data;
+	
+	for (i = 0; i < p_cfg->nb_threads; i++) {
+		printf("Thread %d\n", i);
+		printf("  cpu         : %d (node %d)\n", data[i].cpu, data[i].node);
+		printf("  #add        : %lu\n", data[i].nb_add);
+		printf("  #remove     : %lu\n", data[i].nb_remove);
+		printf("  #contains   : %lu\n", data[i].nb_contains);
+		printf("  #found      : %lu\n", data[i].nb_found);
+		printf("  #value upd  : %lu\n", data[i].nb_value_updates);
+		printf("  unreclaimed : %ld (peak %ld)\n", ST_thread_unreclaimed(data[i].p_st), data[i].st.stats.n_unreclaimed_peak);
+	}
+	printf("Set size       : %d (expected: %d)\n", p_res->size, p_res->expected_size);
+	printf("Duration       : %d (ms)\n", p_res->duration);
+	printf("#ops           : %lu (%f / s)\n", p_res->reads + p_res->updates, p_res->ops_per_sec);
+	printf("#read ops      : %lu (%f / s)\n", p_res->reads, p_res->reads * 1000.0 / p_res->duration);
+	printf("#update ops    : %lu (%f / s)\n", p_res->updates, p_res->updates * 1000.0 / p_res->duration);
+	printf("RSS            : %ld KB (peak: %ld KB, run start: %ld KB)\n", p_res->rss_kb, p_res->peak_rss_kb, p_res->base_rss_kb);
+	printf("Unreclaimed    : %ld nodes (peak %ld)\n", p_res->unreclaimed, p_res->st.n_unreclaimed_peak);
+	if (p_res->n_samples > 0) {
+		printf("Memory samples : every %d ms\n", p_cfg->mem_interval);
+		printf("  %8s %10s %12s  %s\n", "time ms", "rss KB", "unreclaimed", "per thread");
+		for (i = 0; i < p_res->n_samples; i++) {
+			printf("  %8d %10ld %12ld ", p_res->p_samples[i].t_ms, p_res->p_samples[i].rss_kb, p_res->p_samples[i].unreclaimed);
+			for (c = 0; c < p_cfg->nb_threads; c++) {
+				printf(" %ld", p_res->p_thread_samples[i * p_cfg->nb_threads + c]);
+			}
+			printf("\n");
+		}
+		printf("Sampled RSS    : %.0f KB avg, %ld KB peak\n", p_res->rss_avg_kb, p_res->rss_sampled_peak_kb);
+		printf("Sampled unrecl.: %.1f avg, %ld peak\n", p_res->unreclaimed_avg, p_res->unreclaimed_sampled_peak);
+	}
+	printf("Node memory    : %.1f bytes per node\n", p_res->node_bytes);
+	printf("Traversal      : %f nodes / s\n", p_res->traversal);
+	if (p_res->n_intervals > 0) {
+		interval_range(p_res, &min_ops, &max_ops);
+		printf("Intervals      : every %d ms, %.1f to %.1f ops / s\n", p_cfg->interval, min_ops, max_ops);
+		printf("  %8s %14s %10s %10s %8s\n", "time ms", "ops / s", "slow path", "scans", "seg len");
+		for (i = 0; i < p_res->n_intervals; i++) {
+			p_interval = &(p_res->p_intervals[i]);
+			printf("  %8d %14.1f %10ld %10ld %8.2f\n", p_interval->t_ms, interval_ops_per_sec(p_interval),
+				p_interval->slow_path_segments, p_interval->stack_scans,
+				p_interval->splits ? (double)p_interval->split_length / p_interval->splits : 0.0);
+		}
+	}
+	if ((p_cfg->latency != LATENCY_OFF) && (p_res->duration > 0)) {
+		latency_print(p_res->latency, p_cfg->latency, p_res->cycles_per_ns);
+	}
+
+	printf("\n");
+	skiplist_print_stats(p_res->p_set);
+	printf("\n");
+
+	if (p_res->size != p_res->expected_size) {
+		printf("----------------------------\n");
+		printf("WARNING: The set size [%d] is not as expected [%d]\n", p_res->size, p_res->expected_size);
+		printf("----------------------------\n");
+	}
+	
+	if (p_res->bad_values != 0) {
+		printf("----------------------------\n");
+		printf("WARNING: [%lu] values did not match their keys\n", p_res->bad_values);
+		printf("----------------------------\n");
+	}
+}
+
+static double latency_ns(latency_histogram_t *p_hist, double percentile, double cycles_per_ns)
+{
+	if (cycles_per_ns <= 0.0) {
+		return 0.0;
+	}
+	
+	return latency_percentile(p_hist, percentile) / cycles_per_ns;
+}
+
+/* One JSON object per line */
+static void print_run_json(int run, bench_config_t *p_cfg, bench_result_t *p_res)
+{
+	int i, c;
+	interval_sample_t *p_interval;
+	latency_histogram_t *p_hist;
+	st_stats_t *p_st = &(p_res->st);
+	long n_htm_aborts = 0;
+	
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		n_htm_aborts += p_st->n_op_htm_aborts[i];
+	}
+	
+	printf("{\"record\": \"run\", \"run\": %d, \"repetition\": %d, ", run, p_cfg->repetition);
+	
+	printf("\"config\": {\"protocol\": \"%s\", \"alg_type\": %d, \"threads\": %d, \"update\": %d, \"value_update\": %d, "
+		"\"max_segment_len\": %d, \"free_batch\": %d, \"duration_ms\": %d, \"initial\": %d, \"range\": %d, "
+		"\"alternate\": %d, \"scan_mode\": %d, \"scan_kernel\": \"%s\", \"reclaimers\": %d, \"thread_churn\": %d, "
+		"\"allocator\": \"%s\", \"prealloc\": %d, \"htm_backend\": \"%s\", \"warm_start\": %d, \"key_dist\": \"%s\", \"placement\": \"%s\"}, ",
+		alg_type_name(p_cfg->alg_type), p_cfg->alg_type, p_cfg->nb_threads, p_cfg->update, p_cfg->value_update,
+		p_cfg->max_segment_len, p_cfg->max_free_list, p_cfg->duration, p_cfg->initial, p_cfg->range,
+		p_cfg->alternate, p_cfg->scan_mode, ST_scan_kernel_name(p_cfg->scan_kernel), p_cfg->n_reclaimers, p_cfg->thread_churn,
+		ST_allocator_name(p_cfg->allocator), p_cfg->prealloc, HTM_backend_name(p_cfg->htm_backend), p_cfg->warm_start,
+		key_dist_names[key_dist.type], PLACEMENT_name(p_cfg->placement));
+	
+	printf("\"throughput\": {\"duration_ms\": %d, \"ops\": %lu, \"ops_per_sec\": %.1f, \"reads\": %lu, \"updates\": %lu}, ",
+		p_res->duration, p_res->reads + p_res->updates, p_res->ops_per_sec, p_res->reads, p_res->updates);
+	
+	printf("\"threads\": [");
+	for (i = 0; i < p_cfg->nb_threads; i++) {
+		printf("%s{\"cpu\": %d, \"node\": %d, \"add\": %lu, \"remove\": %lu, \"contains\": %lu, \"found\": %lu, \"value_updates\": %lu, "
+			"\"unreclaimed\": %ld, \"unreclaimed_peak\": %ld}",
+			(i > 0) ? ", " : "", p_res->data[i].cpu, p_res->data[i].node, p_res->data[i].nb_add, p_res->data[i].nb_remove, p_res->data[i].nb_contains,
+			p_res->data[i].nb_found, p_res->data[i].nb_value_updates,
+			ST_thread_unreclaimed(p_res->data[i].p_st), p_res->data[i].st.stats.n_unreclaimed_peak);
+	}
+	printf("], ");
+	
+	if (p_res->n_intervals > 0) {
+		printf("\"intervals\": {\"interval_ms\": %d, \"samples\": [", p_cfg->interval);
+		for (i = 0; i < p_res->n_intervals; i++) {
+			p_interval = &(p_res->p_intervals[i]);
+			printf("%s{\"t_ms\": %d, \"ops\": %lu, \"ops_per_sec\": %.1f, \"slow_path_segments\": %ld, "
+				"\"stack_scans\": %ld, \"splits\": %ld, \"split_length\": %ld}",
+				(i > 0) ? ", " : "", p_interval->t_ms, p_interval->ops, interval_ops_per_sec(p_interval),
+				p_interval->slow_path_segments, p_interval->stack_scans, p_interval->splits, p_interval->split_length);
+		}
+		printf("]}, ");
+	}
+	
+	printf("\"set\": {\"size\": %d, \"expected\": %d, \"ok\": %s, \"bad_values\": %lu}, ",
+		p_res->size, p_res->expected_size, (p_res->size == p_res->expected_size) ? "true" : "false", p_res->bad_values);
+	
+	printf("\"memory\": {\"base_rss_kb\": %ld, \"rss_kb\": %ld, \"peak_rss_kb\": %ld, \"node_bytes\": %.1f, \"unreclaimed\": %ld, \"unreclaimed_peak\": %ld",
+		p_res->base_rss_kb, p_res->rss_kb, p_res->peak_rss_kb, p_res->node_bytes, p_res->unreclaimed, p_res->st.n_unreclaimed_peak);
+	if (p_res->n_samples > 0) {
+		printf(", \"sample_ms\": %d, \"rss_avg_kb\": %.0f, \"rss_sampled_peak_kb\": %ld, \"unreclaimed_avg\": %.1f, "
+			"\"unreclaimed_sampled_peak\": %ld, \"samples\": [",
+			p_cfg->mem_interval, p_res->rss_avg_kb, p_res->rss_sampled_peak_kb, p_res->unreclaimed_avg, p_res->unreclaimed_sampled_peak);
+		for (i = 0; i < p_res->n_samples; i++) {
+			printf("%s{\"t_ms\": %d, \"rss_kb\": %ld, \"unreclaimed\": %ld, \"threads\": [", (i > 0) ? ", " : "",
+				p_res->p_samples[i].t_ms, p_res->p_samples[i].rss_kb, p_res->p_samples[i].unreclaimed);
+			for (c = 0; c < p_cfg->nb_threads; c++) {
+				printf("%s%ld", (c > 0) ? ", " : "", p_res->p_thread_samples[i * p_cfg->nb_threads + c]);
+			}
+			printf("]}");
+		}
+		printf("]");
+	}
+	printf("}, ");
+	
+	printf("\"latency_ns\": {");
+	for (i = 0; i < LAT_N_OPS; i++) {
+		p_hist = &(p_res->latency[i]);
+		printf("%s\"%s\": {\"n\": %lu, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"p99.9\": %.0f, \"max\": %.0f}",
+			(i > 0) ? ", " : "", latency_op_names[i], p_hist->n_samples,
+			latency_ns(p_hist, 50.0, p_res->cycles_per_ns), latency_ns(p_hist, 90.0, p_res->cycles_per_ns),
+			latency_ns(p_hist, 99.0, p_res->cycles_per_ns), latency_ns(p_hist, 99.9, p_res->cycles_per_ns),
+			(p_res->cycles_per_ns > 0.0) ? p_hist->max_cycles / p_res->cycles_per_ns : 0.0);
+	}
+	printf("}, ");
+	
+	printf("\"htm\": {\"explicit\": %ld, \"retry\": %ld, \"conflict\": %ld, \"capacity\": %ld, \"debug\": %ld, \"nested\": %ld}, ",
+		p_res->htm.n_xabort_explicit, p_res->htm.n_xabort_retry, p_res->htm.n_xabort_conflict,
+		p_res->htm.n_xabort_capacity, p_res->htm.n_xabort_debug, p_res->htm.n_xabort_nested);
+	
+	printf("\"st\": {\"ops\": %ld, \"splits\": %ld, \"split_length\": %ld, \"slow_path_segments\": %ld, \"htm_aborts\": %ld, "
+		"\"stack_scans\": %ld, \"scan_bytes\": %ld, \"scan_ns\": %ld, \"allocs\": %ld, \"frees\": %ld, "
+		"\"retry_conflict\": %ld, \"retry_capacity\": %ld, \"retry_locked\": %ld, \"retry_other\": %ld, "
+		"\"epoch_scans\": %ld, \"epoch_advances\": %ld, \"era_scans\": %ld, \"era_advances\": %ld, \"era_reservations\": %ld}}\n",
+		p_st->n_ops, p_st->n_splits, p_st->n_split_length, p_st->n_slow_path_segments, n_htm_aborts,
+		p_st->n_stack_scans, p_st->n_scan_bytes, p_st->n_scan_nsec, p_st->n_allocs, p_st->n_frees,
+		p_st->n_retry_conflict, p_st->n_retry_capacity, p_st->n_retry_locked, p_st->n_retry_other,
+		p_st->n_epoch_scans, p_st->n_epoch_advances, p_st->n_era_scans, p_st->n_era_advances, p_st->n_era_reservations);
+}
+
+static void print_run_csv_header()
+{
+	int i;
+	
+	printf("run,repetition,protocol,threads,update,value_update,key_dist,placement,max_segment_len,free_batch,duration_ms,"
+		"ops,ops_per_sec,reads,updates,size,expected_size,size_ok,bad_values,base_rss_kb,rss_kb,peak_rss_kb,node_bytes,"
+		"unreclaimed,unreclaimed_peak,rss_avg_kb,unreclaimed_avg,interval_ops_per_sec_min,interval_ops_per_sec_max");
+	for (i = 0; i < LAT_N_OPS; i++) {
+		printf(",%s_p50_ns,%s_p99_ns,%s_p999_ns,%s_max_ns", latency_op_names[i], latency_op_names[i], 
+			latency_op_names[i], latency_op_names[i]);
+	}
+	printf(",htm_explicit,htm_conflict,htm_capacity,st_splits,st_split_length,st_slow_path_segments,st_htm_aborts,st_stack_scans,thread_ops\n");
+}
+
+static void print_run_csv(int run, bench_config_t *p_cfg, bench_result_t *p_res)
+{
+	int i;
+	latency_histogram_t *p_hist;
+	thread_data_t *data = p_res->data;
+	st_stats_t *p_st = &(p_res->st);
+	long n_htm_aborts = 0;
+	double min_ops, max_ops;
+	
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		n_htm_aborts += p_st->n_op_htm_aborts[i];
+	}
+	interval_range(p_res, &min_ops, &max_ops);
+	
+	printf("%d,%d,%s,%d,%d,%d,%s,%s,%d,%d,%d,%lu,%.1f,%lu,%lu,%d,%d,%d,%lu,%ld,%ld,%ld,%.1f,%ld,%ld,%.0f,%.1f,%.1f,%.1f",
+		run, p_cfg->repetition, alg_type_name(p_cfg->alg_type), p_cfg->nb_threads, p_cfg->update, p_cfg->value_update,
+		key_dist_names[key_dist.type], PLACEMENT_name(p_cfg->placement),
+		p_cfg->max_segment_len, p_cfg->max_free_list, p_res->duration,
+		p_res->reads + p_res->updates, p_res->ops_per_sec, p_res->reads, p_res->updates,
+		p_res->size, p_res->expected_size, (p_res->size == p_res->expected_size), p_res->bad_values,
+		p_res->base_rss_kb, p_res->rss_kb, p_res->peak_rss_kb, p_res->node_bytes,
+		p_res->unreclaimed, p_res->st.n_unreclaimed_peak, p_res->rss_avg_kb, p_res->unreclaimed_avg, min_ops, max_ops);
+	for (i = 0; i < LAT_N_OPS; i++) {
+		p_hist = &(p_res->latency[i]);
+		printf(",%.0f,%.0f,%.0f,%.0f", latency_ns(p_hist, 50.0, p_res->cycles_per_ns), latency_ns(p_hist, 99.0, p_res->cycles_per_ns),
+			latency_ns(p_hist, 99.9, p_res->cycles_per_ns), 
+			(p_res->cycles_per_ns > 0.0) ? p_hist->max_cycles / p_res->cycles_per_ns : 0.0);
+	}
+	printf(",%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,",
+		p_res->htm.n_xabort_explicit, p_res->htm.n_xabort_conflict, p_res->htm.n_xabort_capacity,
+		p_st->n_splits, p_st->n_split_length, p_st->n_slow_path_segments, n_htm_aborts, p_st->n_stack_scans);
+	/* Per-thread operations, separated by ';' */
+	for (i = 0; i < p_cfg->nb_threads; i++) {
+		printf("%s%lu", (i > 0) ? ";" : "", 
+			data[i].nb_add + data[i].nb_remove + data[i].nb_contains + data[i].nb_value_updates);
+	}
+	printf("\n");
+}
+
+/////////////////////////////////////////////////////////
+// SWEEP
+/////////////////////////////////////////////////////////
+
+/* Two-sided 95% Student's t values for 1..30 degrees of freedom */
+static const double t_95[30] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/* Mean, sample standard deviation, and the half width of the 95% 
+ * confidence interval of the mean */
+static void sweep_stats(double *p_values, int n, double *p_mean, double *p_stddev, double *p_ci)
+{
+	int i;
+	double sum = 0.0;
+	double sq_sum = 0.0;
+	
+	for (i = 0; i < n; i++) {
+		sum += p_values[i];
+	}
+	*p_mean = sum / n;
+	
+	if (n < 2) {
+		*p_stddev = 0.0;
+		*p_ci = 0.0;
+		return;
+	}
+	
+	for (i = 0; i < n; i++) {
+		sq_sum += (p_values[i] - *p_mean) * (p_values[i] - *p_mean);
+	}
+	*p_stddev = sqrt(sq_sum / (n - 1));
+	*p_ci = ((n - 1 <= 30) ? t_95[n - 2] : 1.960) * *p_stddev / sqrt((double)n);
+}
+
+/* Writes the telemetry of a run. The runs of a sweep write <path>.<run>. */
+static void export_telemetry(const char *path, int run)
+{
+	char run_path[PATH_MAX];
+	
+	if (run > 0) {
+		snprintf(run_path, sizeof(run_path), "%s.%d", path, run);
+		path = run_path;
+	}
+	
+	if ((ST_telemetry_export(path) == 0) && verbose) {
+		printf("Telemetry      : %s\n", path);
+	}
+}
+
+static void print_summary(int format, bench_config_t *p_cfg, double *p_values, double *p_unreclaimed_peaks, int n)
+{
+	double mean, stddev, ci;
+	double peak_mean, peak_stddev, peak_ci;
+	
+	sweep_stats(p_values, n, &mean, &stddev, &ci);
+	sweep_stats(p_unreclaimed_peaks, n, &peak_mean, &peak_stddev, &peak_ci);
+	
+	if (format == FORMAT_JSON) {
+		printf("{\"record\": \"summary\", \"config\": {\"protocol\": \"%s\", \"threads\": %d, \"update\": %d, "
+			"\"max_segment_len\": %d, \"free_batch\": %d}, \"repetitions\": %d, "
+			"\"ops_per_sec\": {\"mean\": %.1f, \"stddev\": %.1f, \"ci95\": %.1f}, "
+			"\"unreclaimed_peak\": {\"mean\": %.1f, \"stddev\": %.1f, \"ci95\": %.1f}}\n",
+			alg_type_name(p_cfg->alg_type), p_cfg->nb_threads, p_cfg->update, p_cfg->max_segment_len, p_cfg->max_free_list,
+			n, mean, stddev, ci, peak_mean, peak_stddev, peak_ci);
+	} else if (format == FORMAT_CSV) {
+		printf("%s,%d,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.1f\n",
+			alg_type_name(p_cfg->alg_type), p_cfg->nb_threads, p_cfg->update, p_cfg->max_segment_len, p_cfg->max_free_list,
+			n, mean, stddev, ci, peak_mean);
+	} else {
+		printf("  %-15s threads %3d  update %3d  segment %3d  free %4d : %14.1f ops/s +- %.1f (stddev %.1f, %d runs), unreclaimed peak %.0f\n",
+			alg_type_name(p_cfg->alg_type), p_cfg->nb_threads, p_cfg->update, p_cfg->max_segment_len, p_cfg->max_free_list,
+			mean, ci, stddev, n, peak_mean);
+	}
+}
+
+/* Parses a comma separated list of integers */
+static int parse_int_list(char *arg, int *p_values, int max_values, const char *name)
+{
+	int n = 0;
+	char *p_token;
+	
+	for (p_token = strtok(arg, ","); p_token != NULL; p_token = strtok(NULL, ",")) {
+		if (n == max_values) {
+			printf("ERROR: at most %d values of %s.\n", max_values, name);
+			exit(1);
+		}
+		p_values[n++] = atoi(p_token);
+	}
+	
+	if (n == 0) {
+		printf("ERROR: empty %s list.\n", name);
+		exit(1);
+	}
+	
+	return n;
+}
+
+static void print_int_list(const char *label, int *p_values, int n)
+{
+	int i;
+	
+	printf("%s: ", label);
+	for (i = 0; i < n; i++) {
+		printf("%s%d", (i > 0) ? "," : "", p_values[i]);
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct option long_options[] = {
+			// These options don't set a flag
+			{"help",                      no_argument,       NULL, 'h'},
+			{"do-not-alternate",          no_argument,       NULL, 'a'},
+			{"duration",                  required_argument, NULL, 'd'},
+			{"initial-size",              required_argument, NULL, 'i'},
+			{"num-threads",               required_argument, NULL, 'n'},
+			{"range",                     required_argument, NULL, 'r'},
+			{"seed",                      required_argument, NULL, 's'},
+			{"update-rate",               required_argument, NULL, 'u'},
+			{"value-update-rate",         required_argument, NULL, 'v'},
+			{"max-segment-length",        required_argument, NULL, 'l'},
+			{"free-batch-size",           required_argument, NULL, 'f'},
+			{"scan-mode",                 required_argument, NULL, 'm'},
+			{"scan-kernel",               required_argument, NULL, 'k'},
+			{"thread-churn",              required_argument, NULL, 'c'},
+			{"background-reclaimers",     required_argument, NULL, 'b'},
+			{"allocator",                 required_argument, NULL, 'A'},
+			{"prealloc",                  required_argument, NULL, 'P'},
+			{"htm-backend",               required_argument, NULL, 'H'},
+			{"warm-start",                required_argument, NULL, 'w'},
+			{"split-policy",              required_argument, NULL, 'S'},
+			{"telemetry",                 required_argument, NULL, 'T'},
+			{"latency",                   required_argument, NULL, 'L'},
+			{"format",                    required_argument, NULL, 'F'},
+			{"repeat",                    required_argument, NULL, 'R'},
+			{"key-dist",                  required_argument, NULL, 'D'},
+			{"placement",                 required_argument, NULL, 'C'},
+			{"mem-interval",              required_argument, NULL, 'M'},
+			{"interval",                  required_argument, NULL, 'I'},
+			{"zipf-theta",                required_argument, NULL, OPT_ZIPF_THETA},
+			{"hotspot",                   required_argument, NULL, OPT_HOTSPOT},
+			{"window",                    required_argument, NULL, OPT_WINDOW},
+			{"window-step",               required_argument, NULL, OPT_WINDOW_STEP},
+			{"split-max-aborts",          required_argument, NULL, OPT_SPLIT_MAX_ABORTS},
+			{"split-min-length",          required_argument, NULL, OPT_SPLIT_MIN_LENGTH},
+			{"split-len-delta",           required_argument, NULL, OPT_SPLIT_LEN_DELTA},
+			{"split-min-success",         required_argument, NULL, OPT_SPLIT_MIN_SUCCESS},
+			{"alg_type",                  required_argument, NULL, 'p'},
+			{NULL, 0, NULL, 0}
+	};
+
+	int i, c, run, n_runs, n_configs;
+	int ret = 0;
+	bench_config_t cfg;
+	bench_result_t res;
+	double *ops_per_sec;
+	double *unreclaimed_peaks;
+	int alg_types[SWEEP_MAX_VALUES] = {DEFAULT_ALG_TYPE};
+	int n_alg_types = 1;
+	int segment_lens[SWEEP_MAX_VALUES] = {DEFAULT_MAX_SEGMENT_LEN};
+	int n_segment_lens = 1;
+	int free_lists[SWEEP_MAX_VALUES] = {DEFAULT_MAX_FREE_LIST};
+	int n_free_lists = 1;
+	int threads_list[SWEEP_MAX_VALUES] = {DEFAULT_NB_THREADS};
+	int n_threads_list = 1;
+	int updates_list[SWEEP_MAX_VALUES] = {DEFAULT_UPDATE};
+	int n_updates = 1;
+	int scan_mode = DEFAULT_SCAN_MODE;
+	int scan_kernel = DEFAULT_SCAN_KERNEL;
+	int thread_churn = DEFAULT_THREAD_CHURN;
+	int n_reclaimers = DEFAULT_RECLAIMERS;
+	int allocator = DEFAULT_ALLOCATOR;
+	int prealloc = DEFAULT_PREALLOC;
+	int htm_backend = DEFAULT_HTM_BACKEND;
+	int warm_start = DEFAULT_WARM_START;
+	int latency = DEFAULT_LATENCY;
+	int repeat = DEFAULT_REPEAT;
+	int format = DEFAULT_FORMAT;
+	int key_dist_type = DEFAULT_KEY_DIST;
+	double zipf_theta = DEFAULT_ZIPF_THETA;
+	int hot_ops = DEFAULT_HOT_OPS;
+	int hot_keys = DEFAULT_HOT_KEYS;
+	long window = 0;
+	long window_step = DEFAULT_WINDOW_STEP;
+	int placement = DEFAULT_PLACEMENT;
+	int mem_interval = DEFAULT_MEM_INTERVAL;
+	int interval = DEFAULT_INTERVAL;
+	int n_cpus;
+	int max_threads;
+	const placement_cpu_t *p_cpu;
+	int split_policies[ST_MAX_THREADS] = {DEFAULT_SPLIT_POLICY};
+	int n_split_policies = 1;
+	st_split_params_t split_params = {
+		ST_SEGMENT_MAX_HTM_ABORTS,
+		ST_SEGMENT_MIN_LENGTH,
+		ST_SEGMENT_LEN_DELTA,
+		ST_SEGMENT_MIN_SUCCESS_FOR_INC
+	};
+	char *telemetry_path = NULL;
+	int duration = DEFAULT_DURATION;
+	int initial = DEFAULT_INITIAL;
+	int range = DEFAULT_RANGE;
+	int seed = DEFAULT_SEED;
+	int value_update = DEFAULT_VALUE_UPDATE;
+	int alternate = 1;
+
+	while(1) {
+		i = 0;
+		c = getopt_long(argc, argv, "had:i:n:r:s:u:v:l:f:m:k:c:b:A:P:H:w:S:T:L:F:R:D:C:M:I:p:", long_options, &i);
+
+		if(c == -1)
+			break;
+
+		if(c == 0 && long_options[i].flag == 0)
+			c = long_options[i].val;
 
 		switch(c) {
 			case 0:
@@ -320,47 +1770,261 @@ int main(int argc, char **argv)
 					"Options:\n"
 					"  -h, --help\n"
 					"        Print this message\n"
-					"  -p, --protocol-type\n"
+					"  -p, --protocol-type <int>[,<int>...]\n"
 					"        0 - Pure: no memory reclamation\n"
 					"        1 - Hazard Pointers\n"
 					"        2 - Stack Track\n"
-					"  -l, --max-segment-length\n"
+					"        3 - EBR: epoch-based reclamation\n"
+					"        4 - IBR: interval-based reclamation (2GEIBR)\n"
+					"  -H, --htm-backend\n"
+					"        -1 - Auto: RTM if the cpu supports it, software otherwise (default)\n"
+					"        0 - RTM\n"
+					"        1 - Software: a global lock, without rollback\n"
+					"  -l, --max-segment-length <int>[,<int>...]\n"
 					"        Maximum segment length\n"
-					"  -f, --free-batch-size\n"
+					"  -w, --warm-start <int>\n"
+					"        Start new segments from the limits learned by all threads (0=off, 1=on, default=" XSTR(DEFAULT_WARM_START) ")\n"
+					"  -S, --split-policy <int>[,<int>...]\n"
+					"        Segment split policy; a list is assigned to the threads round-robin (default=" XSTR(DEFAULT_SPLIT_POLICY) ")\n"
+					"        0 - Additive: shrink and grow by the length delta\n"
+					"        1 - Multiplicative: halve on a capacity abort, grow by the length delta\n"
+					"        2 - Fixed: always the maximum segment length\n"
+					"      --split-max-aborts <int>\n"
+					"        HTM attempts of a segment before the slow path (default=" XSTR(ST_SEGMENT_MAX_HTM_ABORTS) ")\n"
+					"      --split-min-length <int>\n"
+					"        Minimum segment length (default=" XSTR(ST_SEGMENT_MIN_LENGTH) ")\n"
+					"      --split-len-delta <int>\n"
+					"        Segment length step (default=" XSTR(ST_SEGMENT_LEN_DELTA) ")\n"
+					"      --split-min-success <int>\n"
+					"        Commits of a segment before it grows (default=" XSTR(ST_SEGMENT_MIN_SUCCESS_FOR_INC) ")\n"
+					"  -T, --telemetry <file>\n"
+					"        Write the HTM aborts, slow path entries and commit lengths of every segment as JSON\n"
+					"  -f, --free-batch-size <int>[,<int>...]\n"
 					"        Number of free operations till actual deallocation\n"
+					"  -m, --scan-mode\n"
+					"        0 - Scan the stacks once per freed pointer\n"
+					"        1 - Scan the stacks once per free batch (default=" XSTR(DEFAULT_SCAN_MODE) ")\n"
+					"        2 - Incremental batch scan: one thread per completed operation\n"
+					"  -k, --scan-kernel\n"
+					"        -1 - Auto: the best kernel the cpu supports (default)\n"
+					"        0 - Byte: read a word at every byte offset\n"
+					"        1 - Word: read the aligned words only\n"
+					"        2 - SSE2: aligned words, 2 words per compare\n"
+					"        3 - AVX2: aligned words, 4 words per compare\n"
+					"  -b, --background-reclaimers <int>\n"
+					"        Number of background reclaimer threads (0=reclaim inline, default=" XSTR(DEFAULT_RECLAIMERS) ")\n"
+					"  -A, --allocator\n"
+					"        0 - malloc (default)\n"
+					"        1 - Per-thread pool of cache-line aligned slabs\n"
+					"  -P, --prealloc <int>\n"
+					"        Allocate the inserted node before entering HTM (0=off, 1=on, default=" XSTR(DEFAULT_PREALLOC) ")\n"
+					"  -c, --thread-churn <int>\n"
+					"        Re-register each thread every <int> operations (0=never, default=" XSTR(DEFAULT_THREAD_CHURN) ")\n"
 					"  -a, --do-not-alternate\n"
 					"        Do not alternate insertions and removals\n"
 					"  -d, --duration <int>\n"
 					"        Test duration in milliseconds (0=infinite, default=" XSTR(DEFAULT_DURATION) ")\n"
 					"  -i, --initial-size <int>\n"
 					"        Number of elements to insert before test (default=" XSTR(DEFAULT_INITIAL) ")\n"
-					"  -n, --num-threads <int>\n"
+					"  -n, --num-threads <int>[,<int>...]\n"
 					"        Number of threads (default=" XSTR(DEFAULT_NB_THREADS) ")\n"
 					"  -r, --range <int>\n"
 					"        Range of integer values inserted in set (default=" XSTR(DEFAULT_RANGE) ")\n"
 					"  -s, --seed <int>\n"
 					"        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
-					"  -u, --update-rate <int>\n"
+					"  -L, --latency <int>\n"
+					"        Per-operation latency: 0=off, 1=percentiles, 2=percentiles and raw buckets (default=" XSTR(DEFAULT_LATENCY) ")\n"
+					"  -u, --update-rate <int>[,<int>...]\n"
 					"        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+					"  -v, --value-update-rate <int>\n"
+					"        Percentage of value replacements of present keys (default=" XSTR(DEFAULT_VALUE_UPDATE) ")\n"
+					"  -D, --key-dist <int>\n"
+					"        0 - Uniform over the range (default)\n"
+					"        1 - Zipfian (--zipf-theta, default=" XSTR(DEFAULT_ZIPF_THETA) "), hot keys spread over the range\n"
+					"        2 - Hotspot (--hotspot <ops%%>,<keys%%>, default=" XSTR(DEFAULT_HOT_OPS) "," XSTR(DEFAULT_HOT_KEYS) "): the ops on the first keys\n"
+					"        3 - Sequential: increasing inserts, removes of the oldest key, reads of live keys\n"
+					"        4 - Moving window: uniform in a window (--window <keys>, default=range/10) that slides\n"
+					"            by a key every --window-step ops (default=" XSTR(DEFAULT_WINDOW_STEP) ")\n"
+					"  -I, --interval <int>\n"
+					"        Report the throughput, slow path segments, scans and segment length of every <int> ms\n"
+					"        of a run, read by a sampler thread (0=off, default=" XSTR(DEFAULT_INTERVAL) ")\n"
+					"  -M, --mem-interval <int>\n"
+					"        Sample the RSS and the unreclaimed nodes every <int> ms of a run (0=off, default=" XSTR(DEFAULT_MEM_INTERVAL) ")\n"
+					"  -C, --placement <int>\n"
+					"        Worker thread placement on the allowed cpus, read from the sysfs topology\n"
+					"        0 - None: the OS places the threads (default)\n"
+					"        1 - Compact: the lowest numbered cpus\n"
+					"        2 - Scatter: a thread per core, alternating the NUMA nodes, then the SMT siblings\n"
+					"        3 - SMT: the hardware threads of a core before the next core\n"
+					"        4 - NUMA: round-robin over the NUMA nodes\n"
+					"  -R, --repeat <int>\n"
+					"        Runs of every configuration (default=" XSTR(DEFAULT_REPEAT) ")\n"
+					"  -F, --format <text|json|csv>\n"
+					"        Output format: text, a JSON object per line, or CSV rows (default=text)\n"
+					"\n"
+					"A list of values of -p, -n, -u, -l or -f sweeps all their combinations in one process,\n"
+					"and reports the mean ops/s of every configuration with its 95%% confidence interval.\n"
 					);
 				exit(0);
 			case 'l':
-				max_segment_len = atoi(optarg);
+				n_segment_lens = parse_int_list(optarg, segment_lens, SWEEP_MAX_VALUES, "max segment lengths");
 				break;
 			case 'p':
-				alg_type = atoi(optarg);
-				if ((alg_type != ALG_TYPE_PURE) && 
-				    (alg_type != ALG_TYPE_HAZARD_POINTERS) &&
-				    (alg_type != ALG_TYPE_STACK_TRACK)) {
-					printf("ERROR: protocol type must be 0 (pure) or 1 (hazard pointers) or 2 (stack track).\n");
-					exit(1);
+				n_alg_types = parse_int_list(optarg, alg_types, SWEEP_MAX_VALUES, "protocols");
+				for (i = 0; i < n_alg_types; i++) {
+					if ((alg_types[i] != ALG_TYPE_PURE) && 
+					    (alg_types[i] != ALG_TYPE_HAZARD_POINTERS) &&
+					    (alg_types[i] != ALG_TYPE_STACK_TRACK) &&
+					    (alg_types[i] != ALG_TYPE_EBR) &&
+					    (alg_types[i] != ALG_TYPE_IBR)) {
+						printf("ERROR: protocol type must be 0 (pure), 1 (hazard pointers), 2 (stack track), 3 (ebr) or 4 (ibr).\n");
+						exit(1);
+					}
 				}
 				break;	
 			case 'f':
-				max_free_list = atoi(optarg);
-				if (max_free_list > ST_MAX_FREE_LIST) {
-					printf("ERROR: free batch size must be less than %d\n", ST_MAX_FREE_LIST);
-					exit(1);	
+				n_free_lists = parse_int_list(optarg, free_lists, SWEEP_MAX_VALUES, "free batch sizes");
+				for (i = 0; i < n_free_lists; i++) {
+					if (free_lists[i] > ST_MAX_FREE_LIST) {
+						printf("ERROR: free batch size must be less than %d\n", ST_MAX_FREE_LIST);
+						exit(1);	
+					}
+				}
+				break;
+			case 'm':
+				scan_mode = atoi(optarg);
+				if ((scan_mode != ST_SCAN_MODE_PER_PTR) &&
+				    (scan_mode != ST_SCAN_MODE_BATCH) &&
+				    (scan_mode != ST_SCAN_MODE_INCREMENTAL)) {
+					printf("ERROR: scan mode must be 0 (per pointer) or 1 (batch) or 2 (incremental).\n");
+					exit(1);
+				}
+				break;
+			case 'k':
+				scan_kernel = atoi(optarg);
+				if ((scan_kernel < ST_SCAN_KERNEL_AUTO) ||
+				    (scan_kernel > ST_SCAN_KERNEL_AVX2)) {
+					printf("ERROR: scan kernel must be -1 (auto) or 0 (byte) or 1 (word) or 2 (sse2) or 3 (avx2).\n");
+					exit(1);
+				}
+				break;
+			case 'c':
+				thread_churn = atoi(optarg);
+				break;
+			case 'b':
+				n_reclaimers = atoi(optarg);
+				break;
+			case 'A':
+				allocator = atoi(optarg);
+				if ((allocator != ST_ALLOC_MALLOC) &&
+				    (allocator != ST_ALLOC_POOL)) {
+					printf("ERROR: allocator must be 0 (malloc) or 1 (pool).\n");
+					exit(1);
+				}
+				break;
+			case 'P':
+				prealloc = atoi(optarg);
+				break;
+			case 'w':
+				warm_start = atoi(optarg);
+				break;
+			case 'S':
+				n_split_policies = parse_int_list(optarg, split_policies, ST_MAX_THREADS, "split policies");
+				for (i = 0; i < n_split_policies; i++) {
+					if ((split_policies[i] < 0) ||
+					    (split_policies[i] >= ST_SPLIT_N_POLICIES)) {
+						printf("ERROR: split policy must be 0 (additive) or 1 (multiplicative) or 2 (fixed).\n");
+						exit(1);
+					}
+				}
+				break;
+			case 'F':
+				if (strcmp(optarg, "text") == 0) {
+					format = FORMAT_TEXT;
+				} else if (strcmp(optarg, "json") == 0) {
+					format = FORMAT_JSON;
+				} else if (strcmp(optarg, "csv") == 0) {
+					format = FORMAT_CSV;
+				} else {
+					printf("ERROR: format must be text or json or csv.\n");
+					exit(1);
+				}
+				break;
+			case 'R':
+				repeat = atoi(optarg);
+				break;
+			case 'D':
+				key_dist_type = atoi(optarg);
+				if ((key_dist_type < 0) || (key_dist_type >= KEY_DIST_N)) {
+					printf("ERROR: key distribution must be 0 (uniform) or 1 (zipfian) or 2 (hotspot) or 3 (sequential) or 4 (window).\n");
+					exit(1);
+				}
+				break;
+			case 'I':
+				interval = atoi(optarg);
+				break;
+			case 'M':
+				mem_interval = atoi(optarg);
+				break;
+			case 'C':
+				placement = atoi(optarg);
+				if ((placement < 0) || (placement >= PLACEMENT_N_POLICIES)) {
+					printf("ERROR: placement must be 0 (none) or 1 (compact) or 2 (scatter) or 3 (smt) or 4 (numa).\n");
+					exit(1);
+				}
+				break;
+			case OPT_ZIPF_THETA:
+				zipf_theta = atof(optarg);
+				if ((zipf_theta <= 0.0) || (zipf_theta >= 1.0)) {
+					printf("ERROR: zipf theta must be in (0, 1).\n");
+					exit(1);
+				}
+				break;
+			case OPT_HOTSPOT:
+				if ((sscanf(optarg, "%d,%d", &hot_ops, &hot_keys) != 2) ||
+				    (hot_ops < 0) || (hot_ops > 100) || (hot_keys <= 0) || (hot_keys > 100)) {
+					printf("ERROR: hotspot must be <ops percent>,<keys percent>.\n");
+					exit(1);
+				}
+				break;
+			case OPT_WINDOW:
+				window = atol(optarg);
+				break;
+			case OPT_WINDOW_STEP:
+				window_step = atol(optarg);
+				if (window_step <= 0) {
+					printf("ERROR: window step must be positive.\n");
+					exit(1);
+				}
+				break;
+			case 'L':
+				latency = atoi(optarg);
+				if ((latency < LATENCY_OFF) || (latency > LATENCY_BUCKETS)) {
+					printf("ERROR: latency must be 0 (off) or 1 (percentiles) or 2 (percentiles and buckets).\n");
+					exit(1);
+				}
+				break;
+			case 'T':
+				telemetry_path = optarg;
+				break;
+			case OPT_SPLIT_MAX_ABORTS:
+				split_params.max_htm_aborts = atoi(optarg);
+				break;
+			case OPT_SPLIT_MIN_LENGTH:
+				split_params.min_length = atoi(optarg);
+				break;
+			case OPT_SPLIT_LEN_DELTA:
+				split_params.len_delta = atoi(optarg);
+				break;
+			case OPT_SPLIT_MIN_SUCCESS:
+				split_params.min_success_for_inc = atoi(optarg);
+				break;
+			case 'H':
+				htm_backend = atoi(optarg);
+				if ((htm_backend < HTM_BACKEND_AUTO) ||
+				    (htm_backend > HTM_BACKEND_SOFTWARE)) {
+					printf("ERROR: htm backend must be -1 (auto) or 0 (rtm) or 1 (software).\n");
+					exit(1);
 				}
 				break;
 			case 'a':
@@ -373,7 +2037,7 @@ int main(int argc, char **argv)
 				initial = atoi(optarg);
 				break;
 			case 'n':
-				nb_threads = atoi(optarg);
+				n_threads_list = parse_int_list(optarg, threads_list, SWEEP_MAX_VALUES, "thread counts");
 				break;
 			case 'r':
 				range = atoi(optarg);
@@ -382,7 +2046,10 @@ int main(int argc, char **argv)
 				seed = atoi(optarg);
 				break;
 			case 'u':
-				update = atoi(optarg);
+				n_updates = parse_int_list(optarg, updates_list, SWEEP_MAX_VALUES, "update rates");
+				break;
+			case 'v':
+				value_update = atoi(optarg);
 				break;
 			case '?':
 				printf("Use -h or --help for help\n");
@@ -393,49 +2060,105 @@ int main(int argc, char **argv)
 	}
 
 	assert(duration >= 0);
+	assert(thread_churn >= 0);
+	assert(n_reclaimers >= 0);
 	assert(initial >= 0);
-	assert(nb_threads > 0);
 	assert(range > 0 && range >= initial);
-	assert(update >= 0 && update <= 100);
-
-	if (alg_type == ALG_TYPE_PURE) {
-		printf("Set type           : skip-list [** pure **]\n");
-	} else if (alg_type == ALG_TYPE_HAZARD_POINTERS) {
-		printf("Set type           : skip-list [** hazard pointers **]\n");
-	} else if (alg_type == ALG_TYPE_STACK_TRACK) {
-		printf("Set type           : skip-list [** stack-track **]\n");
-	} else {
-		abort();
-	}
-	printf("Max segment length : %d\n", max_segment_len);
-	printf("Max free list      : %d\n", max_free_list);
-	printf("Duration           : %d\n", duration);
-	printf("Initial size       : %d\n", initial);
-	printf("Nb threads         : %d\n", nb_threads);
-	printf("Value range        : %d\n", range);
-	printf("Seed               : %d\n", seed);
-	printf("Update rate        : %d\n", update);
-	printf("Alternate          : %d\n", alternate);
-	printf("Type sizes         : int=%d/long=%d/ptr=%d/word=%d\n",
-		(int)sizeof(int),
-		(int)sizeof(long),
-		(int)sizeof(void *),
-		(int)sizeof(size_t));
-
-	timeout.tv_sec = duration / 1000;
-	timeout.tv_nsec = (duration % 1000) * 1000000;
-
-	if ((data = (thread_data_t *)malloc(nb_threads * sizeof(thread_data_t))) == NULL) {
-		perror("malloc");
-		exit(1);
+	assert(repeat > 0);
+	assert(mem_interval >= 0);
+	assert(interval >= 0);
+	for (i = 0; i < n_threads_list; i++) {
+		assert(threads_list[i] > 0);
 	}
+	for (i = 0; i < n_updates; i++) {
+		assert(updates_list[i] >= 0 && updates_list[i] <= 100);
+		assert(value_update >= 0 && updates_list[i] + value_update <= 100);
+	}
+	assert(split_params.max_htm_aborts >= 0);
+	assert(split_params.min_length > 0);
+	assert(split_params.len_delta >= 0);
+	assert(split_params.min_success_for_inc >= 0);
 
-	memset(data, 0, nb_threads * sizeof(thread_data_t));
-
-	if ((threads = (pthread_t *)malloc(nb_threads * sizeof(pthread_t))) == NULL) {
-		perror("malloc");
+	n_configs = n_alg_types * n_threads_list * n_updates * n_segment_lens * n_free_lists;
+	n_runs = n_configs * repeat;
+	if ((n_runs > 1) && (duration == 0)) {
+		printf("ERROR: a sweep needs a duration.\n");
+		exit(1);
+	}
+	if (((interval > 0) || (mem_interval > 0)) && (duration == 0)) {
+		printf("ERROR: sampling needs a duration.\n");
 		exit(1);
 	}
+	
+	verbose = (format == FORMAT_TEXT);
+	
+	key_dist_init(&key_dist, key_dist_type, range, zipf_theta, hot_ops, hot_keys, window, window_step);
+
+	htm_backend = HTM_init(htm_backend);
+	ST_model_init(warm_start);
+	ST_split_policy_init(split_policies, n_split_policies, &split_params);
+	ST_telemetry_init(telemetry_path != NULL);
+	scan_kernel = ST_scan_kernel_init(scan_kernel);
+	ST_allocator_init(allocator);
+	ST_prealloc_init(prealloc);
+	n_cpus = PLACEMENT_init(placement);
+	
+	if (verbose) {
+		print_int_list("Protocol           ", alg_types, n_alg_types);
+		printf("HTM backend        : %s\n", HTM_backend_name(htm_backend));
+		print_int_list("Max segment length ", segment_lens, n_segment_lens);
+		printf("Warm start         : %d\n", warm_start);
+		printf("Split policy       : ");
+		for (i = 0; i < n_split_policies; i++) {
+			printf("%s%s", (i > 0) ? "," : "", ST_split_policy_name(split_policies[i]));
+		}
+		printf("\n");
+		print_int_list("Max free list      ", free_lists, n_free_lists);
+		printf("Scan mode          : %d\n", scan_mode);
+		printf("Scan kernel        : %s\n", ST_scan_kernel_name(scan_kernel));
+		printf("Reclaimers         : %d\n", n_reclaimers);
+		printf("Allocator          : %s\n", ST_allocator_name(allocator));
+		printf("Prealloc           : %d\n", prealloc);
+		printf("Thread churn       : %d\n", thread_churn);
+		printf("Duration           : %d\n", duration);
+		printf("Initial size       : %d\n", initial);
+		print_int_list("Nb threads         ", threads_list, n_threads_list);
+		printf("Value range        : %d\n", range);
+		printf("Seed               : %d\n", seed);
+		print_int_list("Update rate        ", updates_list, n_updates);
+		printf("Value update rate  : %d\n", value_update);
+		printf("Key distribution   : %s", key_dist_names[key_dist.type]);
+		if (key_dist.type == KEY_DIST_ZIPF) {
+			printf(" (theta %.2f)", key_dist.theta);
+		} else if (key_dist.type == KEY_DIST_HOTSPOT) {
+			printf(" (%d%% of the ops on %ld keys)", key_dist.hot_ops, key_dist.hot_keys);
+		} else if (key_dist.type == KEY_DIST_WINDOW) {
+			printf(" (%ld keys, a key per %ld ops)", key_dist.window, key_dist.window_step);
+		}
+		printf("\n");
+		printf("Placement          : %s (%d cpus, %d nodes)\n", PLACEMENT_name(placement), n_cpus, PLACEMENT_n_nodes());
+		max_threads = 0;
+		for (i = 0; i < n_threads_list; i++) {
+			if (threads_list[i] > max_threads) {
+				max_threads = threads_list[i];
+			}
+		}
+		for (i = 0; (i < max_threads) && ((p_cpu = PLACEMENT_of(i)) != NULL); i++) {
+			printf("  thread %-3d       : cpu %d (node %d, package %d, core %d, smt %d)\n", 
+				i, p_cpu->cpu, p_cpu->node, p_cpu->package, p_cpu->core, p_cpu->smt);
+		}
+		printf("Interval           : %d\n", interval);
+		printf("Memory interval    : %d\n", mem_interval);
+		printf("Latency            : %d\n", latency);
+		printf("Alternate          : %d\n", alternate);
+		printf("Repeat             : %d\n", repeat);
+		printf("Type sizes         : int=%d/long=%d/ptr=%d/word=%d\n",
+			(int)sizeof(int),
+			(int)sizeof(long),
+			(int)sizeof(void *),
+			(int)sizeof(size_t));
+		printf("Thread state       : %d bytes\n", (int)sizeof(st_thread_t));
+	}
 
 	if (seed == 0) {
 		srand((int)time(NULL));
@@ -443,111 +2166,111 @@ int main(int argc, char **argv)
 		srand(seed);
 	}
 	
-	p_set = skiplist_init();
-	
-	stop = 0;
-
 	if (alternate == 0 && range != initial * 2) {
 		printf("WARNING: range is not twice the initial set size\n");
 	}
-
-	size = initial;
-	printf("Set size           : %d\n", size);
 	
-	/* Access set from all threads */
-	barrier_init(&barrier, nb_threads + 1);
-	pthread_attr_init(&attr);
-	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-	for (i = 0; i < nb_threads; i++) {
-		printf("Creating thread %d\n", i);
-
-		data[i].uniq_id = i;
-		data[i].range = range;
-		data[i].update = update;
-		data[i].alternate = alternate;
-		data[i].nb_add = 0;
-		data[i].nb_remove = 0;
-		data[i].nb_contains = 0;
-		data[i].nb_found = 0;
-		data[i].diff = 0;
-		data[i].p_seed = &(data[i].seed);
-		rand_init(data[i].p_seed);
-		data[i].p_set = p_set;
-		data[i].barrier = &barrier;
-		data[i].initial = initial;
-		data[i].alg_type = alg_type;
-		data[i].max_segment_len = max_segment_len;
-		data[i].max_free_list = max_free_list;
-		data[i].p_st = &(data[i].st);  
-
-		if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
-			fprintf(stderr, "Error creating thread\n");
-			exit(1);
-		}
+	if (((ops_per_sec = (double *)malloc(n_runs * sizeof(double))) == NULL) ||
+	    ((unreclaimed_peaks = (double *)malloc(n_runs * sizeof(double))) == NULL)) {
+		perror("malloc");
+		exit(1);
 	}
-	pthread_attr_destroy(&attr);
-
-	/* Start threads */
-	barrier_cross(&barrier);
-
-	printf("STARTING...\n");
-	gettimeofday(&start, NULL);
-	if (duration > 0) {
-		nanosleep(&timeout, NULL);
-	} else {
-		sigemptyset(&block_set);
-		sigsuspend(&block_set);
+	
+	if (format == FORMAT_CSV) {
+		print_run_csv_header();
 	}
-	stop = 1;
-	gettimeofday(&end, NULL);
-	printf("STOPPING...\n");
-
-	/* Wait for thread completion */
-	for (i = 0; i < nb_threads; i++) {
-		if (pthread_join(threads[i], NULL) != 0) {
-			fprintf(stderr, "Error waiting for thread completion\n");
-			exit(1);
+	
+	cfg.value_update = value_update;
+	cfg.duration = duration;
+	cfg.initial = initial;
+	cfg.range = range;
+	cfg.alternate = alternate;
+	cfg.scan_mode = scan_mode;
+	cfg.scan_kernel = scan_kernel;
+	cfg.thread_churn = thread_churn;
+	cfg.n_reclaimers = n_reclaimers;
+	cfg.allocator = allocator;
+	cfg.prealloc = prealloc;
+	cfg.htm_backend = htm_backend;
+	cfg.warm_start = warm_start;
+	cfg.latency = latency;
+	cfg.placement = placement;
+	cfg.mem_interval = mem_interval;
+	cfg.interval = interval;
+	
+	/* The runs of a configuration are adjacent, the free batch varies fastest */
+	for (run = 0; run < n_runs; run++) {
+		c = run / repeat;
+		cfg.repetition = (run % repeat) + 1;
+		cfg.max_free_list = free_lists[c % n_free_lists];
+		c /= n_free_lists;
+		cfg.max_segment_len = segment_lens[c % n_segment_lens];
+		c /= n_segment_lens;
+		cfg.update = updates_list[c % n_updates];
+		c /= n_updates;
+		cfg.nb_threads = threads_list[c % n_threads_list];
+		c /= n_threads_list;
+		cfg.alg_type = alg_types[c];
+		
+		if (verbose && (n_runs > 1)) {
+			printf("\n=================================================\n");
+			printf("Run %d/%d : protocol %d, threads %d, update %d, max segment length %d, free batch %d, repetition %d\n",
+				run + 1, n_runs, cfg.alg_type, cfg.nb_threads, cfg.update, cfg.max_segment_len, cfg.max_free_list, cfg.repetition);
+			printf("=================================================\n");
 		}
+		
+		run_bench(&cfg, &res);
+		ops_per_sec[run] = res.ops_per_sec;
+		unreclaimed_peaks[run] = res.st.n_unreclaimed_peak;
+		if ((res.size != res.expected_size) || (res.bad_values != 0)) {
+			ret = 1;
+		}
+		
+		if (format == FORMAT_JSON) {
+			print_run_json(run + 1, &cfg, &res);
+		} else if (format == FORMAT_CSV) {
+			print_run_csv(run + 1, &cfg, &res);
+		} else {
+			print_run_text(&cfg, &res);
+		}
+		
+		if (telemetry_path != NULL) {
+			export_telemetry(telemetry_path, (n_runs > 1) ? run + 1 : 0);
+		}
+		
+		free_set(&cfg, &res);
+		munmap(res.data, cfg.nb_threads * sizeof(thread_data_t));
+		free(res.p_samples);
+		free(res.p_thread_samples);
+		free(res.p_intervals);
 	}
-
-	duration = (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
-	reads = 0;
-	updates = 0;
-	for (i = 0; i < nb_threads; i++) {
-		printf("Thread %d\n", i);
-		printf("  #add        : %lu\n", data[i].nb_add);
-		printf("  #remove     : %lu\n", data[i].nb_remove);
-		printf("  #contains   : %lu\n", data[i].nb_contains);
-		printf("  #found      : %lu\n", data[i].nb_found);
-		reads += data[i].nb_contains;
-		updates += (data[i].nb_add + data[i].nb_remove);
-		size += data[i].diff;
-	}
-	cur_size = skiplist_size(p_set); 
-	printf("Set size       : %d (expected: %d)\n", cur_size, size);
-	printf("Duration       : %d (ms)\n", duration);
-	printf("#ops           : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
-	printf("#read ops      : %lu (%f / s)\n", reads, reads * 1000.0 / duration);
-	printf("#update ops    : %lu (%f / s)\n", updates, updates * 1000.0 / duration);
-
-	printf("\n");
-	skiplist_print_stats(p_set);
-	printf("\n");
-
-	if (cur_size != size) {
-		printf("----------------------------\n");
-		printf("WARNING: The set size [%d] is not as expected [%d]\n", cur_size, size);
-		printf("----------------------------\n");
+	
+	if (n_runs > 1) {
+		if (format == FORMAT_CSV) {
+			printf("\nprotocol,threads,update,max_segment_len,free_batch,repetitions,ops_per_sec_mean,ops_per_sec_stddev,ops_per_sec_ci95,unreclaimed_peak_mean\n");
+		} else if (format == FORMAT_TEXT) {
+			printf("Sweep summary (ops/s, mean +- 95%% confidence interval):\n");
+		}
+		
+		for (c = 0; c < n_configs; c++) {
+			/* The configuration of the first run of c */
+			run = c;
+			cfg.max_free_list = free_lists[run % n_free_lists];
+			run /= n_free_lists;
+			cfg.max_segment_len = segment_lens[run % n_segment_lens];
+			run /= n_segment_lens;
+			cfg.update = updates_list[run % n_updates];
+			run /= n_updates;
+			cfg.nb_threads = threads_list[run % n_threads_list];
+			run /= n_threads_list;
+			cfg.alg_type = alg_types[run];
+			
+			print_summary(format, &cfg, &(ops_per_sec[c * repeat]), &(unreclaimed_peaks[c * repeat]), repeat);
+		}
 	}
 	
-	/* Delete set */
-	//
-
-	/* Cleanup */
-	//
-
-	free(threads);
-	free(data);
+	free(ops_per_sec);
+	free(unreclaimed_peaks);
 
 	return ret;
 }
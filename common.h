@@ -14,6 +14,8 @@
 #define likely(x) __builtin_expect ((x), 1)
 #define unlikely(x) __builtin_expect ((x), 0)
 
+#define UNUSED __attribute__((unused))
+
 /////////////////////////////////////////////////////////
 // TYPES
 /////////////////////////////////////////////////////////
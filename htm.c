@@ -1,6 +1,9 @@
 
+#include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <cpuid.h>
 #include "atomics.h"
 #include "htm.h"
 
@@ -29,6 +32,11 @@ typedef struct htm_data {
 
 htm_data_t g_htm_data = {0,};
 
+int g_htm_backend = HTM_BACKEND_RTM;
+
+// The software backend runs one transaction at a time
+static volatile long g_htm_sw_lock __attribute__((aligned(64))) = 0;
+
 /////////////////////////////////////////////////////////
 // INTERNAL FUNCTIONS
 /////////////////////////////////////////////////////////
@@ -62,19 +70,119 @@ void HTM_status_collect(htm_thread_data_t *self, unsigned int status)
 	
 }
 
+// RTM is usable if cpuid reports it, and the microcode did not turn it
+// into an always-abort instruction
+static int HTM_rtm_is_supported() {
+	unsigned int eax, ebx, ecx, edx;
+	
+	if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) {
+		return 0;
+	}
+	
+	return ((ebx & bit_RTM) != 0) && ((edx & (1 << 11)) == 0);
+}
+
+/////////////////////////////////////////////////////////
+// RTM BACKEND
+/////////////////////////////////////////////////////////
+__attribute__((target("rtm")))
+static int HTM_rtm_start(htm_thread_data_t *self) {
+	unsigned int status = 0;
+	status = _xbegin();
+	if (status != _XBEGIN_STARTED)
+	{
+		self->last_htm_abort = status;
+		HTM_status_collect(self, status);
+		return 0;
+	}
+	return 1;
+}
+
+__attribute__((target("rtm")))
+static void HTM_rtm_commit() {
+	_xend();
+}
+
+__attribute__((target("rtm")))
+static void HTM_rtm_abort_locked() {
+	_xabort(HTM_ABORT_LOCKED);
+}
+
+/////////////////////////////////////////////////////////
+// SOFTWARE BACKEND
+//
+// A transaction holds a global lock. It is never rolled back, so it gets
+// atomicity only against other transactions, and code that may abort 
+// explicitly must take its locks for real when HTM_is_software(). A busy 
+// global lock is reported as a conflict abort, so the caller retries and 
+// falls back to its slow path, as it does on RTM.
+/////////////////////////////////////////////////////////
+static int HTM_sw_start(htm_thread_data_t *self) {
+	int n_spins;
+	unsigned int status;
+	
+	for (n_spins = 0; n_spins < HTM_SW_MAX_SPINS; n_spins++) {
+		if ((g_htm_sw_lock == 0) && (CAS(&g_htm_sw_lock, 0, 1) == 0)) {
+			return 1;
+		}
+		CPU_RELAX;
+	}
+	
+	status = _XABORT_RETRY | _XABORT_CONFLICT;
+	self->last_htm_abort = status;
+	HTM_status_collect(self, status);
+	return 0;
+}
+
+static void HTM_sw_commit() {
+	MEMBARSTLD();
+	g_htm_sw_lock = 0;
+}
+
+static void HTM_sw_lock() {
+	while (1) {
+		if ((g_htm_sw_lock == 0) && (CAS(&g_htm_sw_lock, 0, 1) == 0)) {
+			return;
+		}
+		CPU_RELAX;
+	}
+}
+
 /////////////////////////////////////////////////////////
 // EXTERNAL FUNCTIONS
 /////////////////////////////////////////////////////////
-void HTM_init() {}
+int HTM_init(int backend) {
+	if (backend == HTM_BACKEND_AUTO) {
+		backend = HTM_rtm_is_supported() ? HTM_BACKEND_RTM : HTM_BACKEND_SOFTWARE;
+	}
+	
+	if ((backend == HTM_BACKEND_RTM) && (!HTM_rtm_is_supported())) {
+		printf("ERROR: the cpu does not support RTM\n");
+		exit(1);
+	}
+	
+	g_htm_backend = backend;
+	return backend;
+}
 
 void HTM_finish() {}
 
+const char *HTM_backend_name(int backend) {
+	switch (backend) {
+		case HTM_BACKEND_AUTO: return "auto";
+		case HTM_BACKEND_RTM: return "rtm";
+		case HTM_BACKEND_SOFTWARE: return "software";
+		default: return "unknown";
+	}
+}
+
 void HTM_thread_init(htm_thread_data_t *self) {
 	memset(self, 0, sizeof(htm_thread_data_t));
 }
 
 void HTM_thread_finish(htm_thread_data_t *self) {
 	atomic_add(&(g_htm_data.n_xabort_explicit), self->n_xabort_explicit);
+	atomic_add(&(g_htm_data.n_xabort_retry), self->n_xabort_retry);
 	atomic_add(&(g_htm_data.n_xabort_conflict), self->n_xabort_conflict);
 	atomic_add(&(g_htm_data.n_xabort_capacity), self->n_xabort_capacity);
 	atomic_add(&(g_htm_data.n_xabort_debug), self->n_xabort_debug);
@@ -82,28 +190,63 @@ void HTM_thread_finish(htm_thread_data_t *self) {
 }
 
 int HTM_start(htm_thread_data_t *self) {
-	unsigned int status = 0;
-	status = _xbegin();
-	if (status != _XBEGIN_STARTED)
-	{
-		self->last_htm_abort = status;
-		HTM_status_collect(self, status);
-		return 0;
+	if (HTM_is_software()) {
+		return HTM_sw_start(self);
 	}
-	return 1;
+	return HTM_rtm_start(self);
 }
 
 void HTM_commit() {
-	_xend();
+	if (HTM_is_software()) {
+		HTM_sw_commit();
+		return;
+	}
+	HTM_rtm_commit();
+}
+
+// Unreachable on the software backend: sl_node_lock takes the lock with a 
+// CAS there, since a software transaction cannot roll back
+void HTM_abort_locked() {
+	assert(!HTM_is_software());
+	HTM_rtm_abort_locked();
+}
+
+// A software transaction is not aborted by the stores of non-transactional
+// code, so code that must not run concurrently with any transaction (the
+// stack-track scanner) holds the global lock. A no-op on RTM.
+void HTM_exclude_start() {
+	if (HTM_is_software()) {
+		HTM_sw_lock();
+	}
+}
+
+void HTM_exclude_finish() {
+	if (HTM_is_software()) {
+		HTM_sw_commit();
+	}
+}
+
+void HTM_get_stats(htm_stats_t *p_stats) {
+	p_stats->n_xabort_explicit = g_htm_data.n_xabort_explicit;
+	p_stats->n_xabort_retry = g_htm_data.n_xabort_retry;
+	p_stats->n_xabort_conflict = g_htm_data.n_xabort_conflict;
+	p_stats->n_xabort_capacity = g_htm_data.n_xabort_capacity;
+	p_stats->n_xabort_debug = g_htm_data.n_xabort_debug;
+	p_stats->n_xabort_nested = g_htm_data.n_xabort_nested;
+}
+
+// Only between runs, when no thread is registered
+void HTM_reset_stats() {
+	memset((void *)&g_htm_data, 0, sizeof(htm_data_t));
 }
 
 void HTM_print_stats() {
 	printf("-------------------------------------------------\n");
 	printf("  HTM aborts status:\n");
+	printf("    backend = %s\n", HTM_backend_name(g_htm_backend));
 	printf("    t_htm_conflict = %lu\n", g_htm_data.n_xabort_conflict);
 	printf("    t_htm_capacity = %lu\n", g_htm_data.n_xabort_capacity);
 	printf("    t_htm_explicit = %lu\n", g_htm_data.n_xabort_explicit);
 	printf("-------------------------------------------------\n");
 }
 
-
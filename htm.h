@@ -10,7 +10,16 @@
 /////////////////////////////////////////////////////////
 // DEFINES
 /////////////////////////////////////////////////////////
-#define HTM_abort(abort_code) _xabort(abort_code)
+#define HTM_BACKEND_AUTO (-1)
+#define HTM_BACKEND_RTM (0)
+#define HTM_BACKEND_SOFTWARE (1)
+
+// The explicit abort code of a transaction that found a lock taken
+#define HTM_ABORT_LOCKED (123)
+
+// A software transaction waits this long for the global lock before it
+// reports a conflict abort
+#define HTM_SW_MAX_SPINS (1000)
 
 /////////////////////////////////////////////////////////
 // TYPES
@@ -28,18 +37,50 @@ typedef struct htm_thread_data {
 
 } htm_thread_data_t;
 
+// The abort counts of the finished threads
+typedef struct htm_stats {
+
+	long n_xabort_explicit;
+	long n_xabort_retry;
+	long n_xabort_conflict;
+	long n_xabort_capacity;
+	long n_xabort_debug;
+	long n_xabort_nested;
+
+} htm_stats_t;
+
+/////////////////////////////////////////////////////////
+// GLOBALS
+/////////////////////////////////////////////////////////
+
+// Set once by HTM_init, before any thread starts
+extern int g_htm_backend;
+
+// Software transactions hold a global lock, and cannot roll back, so they 
+// must not abort explicitly
+static inline int HTM_is_software() {
+	return g_htm_backend == HTM_BACKEND_SOFTWARE;
+}
+
 /////////////////////////////////////////////////////////
 // EXTERNAL FUNCTIONS
 /////////////////////////////////////////////////////////
-void HTM_init();
+int HTM_init(int backend);
 void HTM_finish();
+const char *HTM_backend_name(int backend);
 
 void HTM_thread_init(htm_thread_data_t *self);
 void HTM_thread_finish(htm_thread_data_t *self);
 
 int HTM_start(htm_thread_data_t *self);
 void HTM_commit();
+void HTM_abort_locked();
+
+void HTM_exclude_start();
+void HTM_exclude_finish();
 
+void HTM_get_stats(htm_stats_t *p_stats);
+void HTM_reset_stats();
 void HTM_print_stats();
 
 #endif // HTM_H
\ No newline at end of file
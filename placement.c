@@ -0,0 +1,289 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+#include "placement.h"
+
+/////////////////////////////////////////////////////////
+// DEFINES
+/////////////////////////////////////////////////////////
+#define PLACEMENT_SYSFS_CPU "/sys/devices/system/cpu"
+
+/////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////
+
+typedef struct placement_entry {
+	placement_cpu_t info;
+
+	// the rank of the core among the cores of its node
+	int core_rank;
+
+	// the rank of the cpu among the cpus of its node
+	int node_rank;
+} placement_entry_t;
+
+/////////////////////////////////////////////////////////
+// GLOBALS
+/////////////////////////////////////////////////////////
+
+static int g_placement_policy = PLACEMENT_NONE;
+
+static placement_entry_t g_placement_cpus[PLACEMENT_MAX_CPUS];
+static int g_placement_n_cpus = 0;
+static int g_placement_n_nodes = 1;
+
+static cpu_set_t g_placement_initial_set;
+
+static const char *g_placement_names[PLACEMENT_N_POLICIES] = {
+	"none",
+	"compact",
+	"scatter",
+	"smt",
+	"numa"
+};
+
+/////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////
+
+static int PLACEMENT_read_int(int cpu, const char *name, int default_value) {
+	char path[256];
+	FILE *p_file;
+	int value;
+
+	snprintf(path, sizeof(path), PLACEMENT_SYSFS_CPU "/cpu%d/topology/%s", cpu, name);
+
+	p_file = fopen(path, "r");
+	if (p_file == NULL) {
+		return default_value;
+	}
+
+	if ((fscanf(p_file, "%d", &value) != 1) || (value < 0)) {
+		value = default_value;
+	}
+
+	fclose(p_file);
+
+	return value;
+}
+
+// A cpu directory links to its node as "nodeN"
+static int PLACEMENT_read_node(int cpu) {
+	char path[256];
+	DIR *p_dir;
+	struct dirent *p_ent;
+	int node = 0;
+
+	snprintf(path, sizeof(path), PLACEMENT_SYSFS_CPU "/cpu%d", cpu);
+
+	p_dir = opendir(path);
+	if (p_dir == NULL) {
+		return 0;
+	}
+
+	while ((p_ent = readdir(p_dir)) != NULL) {
+		if (sscanf(p_ent->d_name, "node%d", &node) == 1) {
+			break;
+		}
+		node = 0;
+	}
+
+	closedir(p_dir);
+
+	return node;
+}
+
+static int PLACEMENT_compare(const void *p_a, const void *p_b) {
+	const placement_entry_t *p_x = (const placement_entry_t *)p_a;
+	const placement_entry_t *p_y = (const placement_entry_t *)p_b;
+	int keys_x[4];
+	int keys_y[4];
+	int n_keys = 0;
+	int i;
+
+	switch (g_placement_policy) {
+		case PLACEMENT_SCATTER:
+			// a thread per core, alternating the nodes, then the siblings
+			keys_x[0] = p_x->info.smt;       keys_y[0] = p_y->info.smt;
+			keys_x[1] = p_x->core_rank;      keys_y[1] = p_y->core_rank;
+			keys_x[2] = p_x->info.node;      keys_y[2] = p_y->info.node;
+			keys_x[3] = p_x->info.package;   keys_y[3] = p_y->info.package;
+			n_keys = 4;
+			break;
+
+		case PLACEMENT_SMT:
+			// the hardware threads of a core, then the next core of the node
+			keys_x[0] = p_x->info.node;      keys_y[0] = p_y->info.node;
+			keys_x[1] = p_x->info.package;   keys_y[1] = p_y->info.package;
+			keys_x[2] = p_x->info.core;      keys_y[2] = p_y->info.core;
+			keys_x[3] = p_x->info.smt;       keys_y[3] = p_y->info.smt;
+			n_keys = 4;
+			break;
+
+		case PLACEMENT_NUMA:
+			// round-robin over the nodes, in cpu order within a node
+			keys_x[0] = p_x->node_rank;      keys_y[0] = p_y->node_rank;
+			keys_x[1] = p_x->info.node;      keys_y[1] = p_y->info.node;
+			n_keys = 2;
+			break;
+
+		default:
+			// compact: the lowest numbered cpus
+			break;
+	}
+
+	for (i = 0; i < n_keys; i++) {
+		if (keys_x[i] != keys_y[i]) {
+			return (keys_x[i] < keys_y[i]) ? -1 : 1;
+		}
+	}
+
+	return p_x->info.cpu - p_y->info.cpu;
+}
+
+/////////////////////////////////////////////////////////
+// EXTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////
+int PLACEMENT_init(int policy) {
+	int cpu;
+	int i, j;
+	placement_entry_t *p_ent;
+	placement_entry_t *p_other;
+
+	g_placement_policy = policy;
+	g_placement_n_cpus = 0;
+
+	if (sched_getaffinity(0, sizeof(cpu_set_t), &g_placement_initial_set) != 0) {
+		perror("sched_getaffinity");
+		exit(1);
+	}
+
+	for (cpu = 0; (cpu < CPU_SETSIZE) && (g_placement_n_cpus < PLACEMENT_MAX_CPUS); cpu++) {
+		if (!CPU_ISSET(cpu, &g_placement_initial_set)) {
+			continue;
+		}
+
+		p_ent = &(g_placement_cpus[g_placement_n_cpus]);
+		memset(p_ent, 0, sizeof(placement_entry_t));
+
+		// Without a topology every cpu is a core of node 0
+		p_ent->info.cpu = cpu;
+		p_ent->info.node = PLACEMENT_read_node(cpu);
+		p_ent->info.package = PLACEMENT_read_int(cpu, "physical_package_id", 0);
+		p_ent->info.core = PLACEMENT_read_int(cpu, "core_id", cpu);
+
+		g_placement_n_cpus++;
+	}
+
+	// The cpus are in increasing order, so the lower siblings come first
+	for (i = 0; i < g_placement_n_cpus; i++) {
+		p_ent = &(g_placement_cpus[i]);
+
+		for (j = 0; j < i; j++) {
+			p_other = &(g_placement_cpus[j]);
+
+			if ((p_other->info.package == p_ent->info.package) &&
+			    (p_other->info.core == p_ent->info.core)) {
+				p_ent->info.smt++;
+			}
+
+			if (p_other->info.node == p_ent->info.node) {
+				p_ent->node_rank++;
+			}
+		}
+	}
+
+	g_placement_n_nodes = 0;
+	for (i = 0; i < g_placement_n_cpus; i++) {
+		p_ent = &(g_placement_cpus[i]);
+
+		if (p_ent->node_rank == 0) {
+			g_placement_n_nodes++;
+		}
+
+		for (j = 0; j < g_placement_n_cpus; j++) {
+			p_other = &(g_placement_cpus[j]);
+
+			if ((p_other->info.node == p_ent->info.node) && (p_other->info.smt == 0) &&
+			    ((p_other->info.package < p_ent->info.package) ||
+			     ((p_other->info.package == p_ent->info.package) && (p_other->info.core < p_ent->info.core)))) {
+				p_ent->core_rank++;
+			}
+		}
+	}
+
+	if (policy != PLACEMENT_NONE) {
+		qsort(g_placement_cpus, g_placement_n_cpus, sizeof(placement_entry_t), PLACEMENT_compare);
+	}
+
+	return g_placement_n_cpus;
+}
+
+const char *PLACEMENT_name(int policy) {
+	if ((policy < 0) || (policy >= PLACEMENT_N_POLICIES)) {
+		return "unknown";
+	}
+
+	return g_placement_names[policy];
+}
+
+int PLACEMENT_n_nodes() {
+	return g_placement_n_nodes;
+}
+
+const placement_cpu_t *PLACEMENT_of(int thread_index) {
+	if ((g_placement_policy == PLACEMENT_NONE) || (g_placement_n_cpus == 0)) {
+		return NULL;
+	}
+
+	return &(g_placement_cpus[thread_index % g_placement_n_cpus].info);
+}
+
+void PLACEMENT_bind(int cpu) {
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+		fprintf(stderr, "Error binding to cpu %d\n", cpu);
+		exit(1);
+	}
+}
+
+void PLACEMENT_unbind() {
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &g_placement_initial_set) != 0) {
+		fprintf(stderr, "Error restoring the cpu affinity\n");
+		exit(1);
+	}
+}
+
+void PLACEMENT_attr_set(pthread_attr_t *p_attr, int cpu) {
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	if (pthread_attr_setaffinity_np(p_attr, sizeof(cpu_set_t), &set) != 0) {
+		fprintf(stderr, "Error setting the affinity of a thread to cpu %d\n", cpu);
+		exit(1);
+	}
+}
+
+void PLACEMENT_current(int *p_cpu, int *p_node) {
+	unsigned int cpu;
+	unsigned int node;
+
+	if (getcpu(&cpu, &node) != 0) {
+		cpu = 0;
+		node = 0;
+	}
+
+	*p_cpu = (int)cpu;
+	*p_node = (int)node;
+}
@@ -0,0 +1,58 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H 1
+
+/////////////////////////////////////////////////////////
+// INCLUDES
+/////////////////////////////////////////////////////////
+#include <pthread.h>
+
+/////////////////////////////////////////////////////////
+// DEFINES
+/////////////////////////////////////////////////////////
+#define PLACEMENT_NONE (0)
+#define PLACEMENT_COMPACT (1)
+#define PLACEMENT_SCATTER (2)
+#define PLACEMENT_SMT (3)
+#define PLACEMENT_NUMA (4)
+#define PLACEMENT_N_POLICIES (5)
+
+#define PLACEMENT_MAX_CPUS (1024)
+
+/////////////////////////////////////////////////////////
+// TYPES
+/////////////////////////////////////////////////////////
+typedef struct placement_cpu {
+	int cpu;
+	int node;
+	int package;
+	int core;
+
+	// the index of the cpu among the hardware threads of its core
+	int smt;
+} placement_cpu_t;
+
+/////////////////////////////////////////////////////////
+// EXTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////
+
+// Reads the topology of the allowed cpus from sysfs, and orders them by the
+// policy. Returns the number of allowed cpus.
+int PLACEMENT_init(int policy);
+const char *PLACEMENT_name(int policy);
+int PLACEMENT_n_nodes();
+
+// The cpu of a thread index, NULL without a placement. Threads beyond the
+// number of cpus wrap around.
+const placement_cpu_t *PLACEMENT_of(int thread_index);
+
+// Binds the calling thread to a cpu, and back to the initial cpus
+void PLACEMENT_bind(int cpu);
+void PLACEMENT_unbind();
+
+// Creates threads bound to a cpu
+void PLACEMENT_attr_set(pthread_attr_t *p_attr, int cpu);
+
+// The cpu and node the calling thread runs on
+void PLACEMENT_current(int *p_cpu, int *p_node);
+
+#endif // PLACEMENT_H
@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "atomics.h"
+#include "pool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// TYPES
+///////////////////////////////////////////////////////////////////////////////
+
+// The slab header occupies the first cache line of the slab
+typedef struct _pool_slab_t {
+	pool_t *p_owner;
+	int size_class;
+	char padding[POOL_CACHE_LINE - sizeof(pool_t *) - sizeof(int)];
+} pool_slab_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// GLOBALS
+///////////////////////////////////////////////////////////////////////////////
+
+// Pools are never destroyed, because other threads may still free objects
+// into them. A released pool is reused by the next thread on the same NUMA
+// node, since its slabs were first touched on that node.
+static pool_t *volatile g_pools[POOL_MAX_POOLS];
+static volatile int64_t g_n_pools = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+static inline pool_slab_t *POOL_slab_of(void *p_obj) {
+	return (pool_slab_t *)((uintptr_t)p_obj & ~(uintptr_t)(POOL_SLAB_SIZE - 1));
+}
+
+static void POOL_slab_alloc(pool_t *p_pool, int size_class) {
+	pool_slab_t *p_slab;
+
+	p_slab = (pool_slab_t *)aligned_alloc(POOL_SLAB_SIZE, POOL_SLAB_SIZE);
+	if (p_slab == NULL) {
+		abort();
+	}
+
+	p_slab->p_owner = p_pool;
+	p_slab->size_class = size_class;
+
+	p_pool->p_bump[size_class] = (char *)p_slab + sizeof(pool_slab_t);
+	p_pool->p_bump_end[size_class] = (char *)p_slab + POOL_SLAB_SIZE;
+	p_pool->stats.n_slabs++;
+}
+
+// Moves the objects freed by other threads to the local free lists
+static void POOL_drain_remote(pool_t *p_pool) {
+	pool_obj_t *p_obj;
+	pool_obj_t *p_next;
+	int size_class;
+
+	do {
+		p_obj = p_pool->p_remote_free;
+	} while (CAS((volatile int64_t *)&(p_pool->p_remote_free), (int64_t)p_obj, 0) != (int64_t)p_obj);
+
+	while (p_obj != NULL) {
+		p_next = p_obj->p_next;
+
+		size_class = POOL_slab_of(p_obj)->size_class;
+		p_obj->p_next = p_pool->free_lists[size_class];
+		p_pool->free_lists[size_class] = p_obj;
+
+		p_obj = p_next;
+	}
+
+}
+
+static void POOL_remote_flush(pool_t *p_pool, pool_remote_buffer_t *p_buf) {
+	pool_t *p_owner = p_buf->p_owner;
+	pool_obj_t *p_head;
+
+	if (p_buf->n_objs == 0) {
+		return;
+	}
+
+	do {
+		p_head = p_owner->p_remote_free;
+		p_buf->p_last->p_next = p_head;
+	} while (CAS((volatile int64_t *)&(p_owner->p_remote_free), (int64_t)p_head, (int64_t)p_buf->p_first) != (int64_t)p_head);
+
+	p_pool->stats.n_remote_flushes++;
+
+	p_buf->p_owner = NULL;
+	p_buf->p_first = NULL;
+	p_buf->p_last = NULL;
+	p_buf->n_objs = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EXTERNAL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+pool_t *POOL_acquire() {
+	int i;
+	int64_t n_pools;
+	pool_t *p_pool;
+	unsigned int cpu;
+	unsigned int node;
+
+	if (getcpu(&cpu, &node) != 0) {
+		node = 0;
+	}
+
+	n_pools = g_n_pools;
+	for (i = 0; i < n_pools; i++) {
+		p_pool = g_pools[i];
+		if ((p_pool != NULL) && (p_pool->node == (int)node) && 
+		    (p_pool->is_in_use == 0) && (CAS(&(p_pool->is_in_use), 0, 1) == 0)) {
+			return p_pool;
+		}
+	}
+
+	p_pool = (pool_t *)aligned_alloc(POOL_CACHE_LINE, sizeof(pool_t));
+	if (p_pool == NULL) {
+		abort();
+	}
+	memset(p_pool, 0, sizeof(pool_t));
+	p_pool->is_in_use = 1;
+	p_pool->node = (int)node;
+
+	i = atomic_add(&g_n_pools, 1);
+	if (i >= POOL_MAX_POOLS) {
+		printf("ERROR: too many pools (max = %d)\n", POOL_MAX_POOLS);
+		abort();
+	}
+	g_pools[i] = p_pool;
+
+	return p_pool;
+}
+
+void POOL_release(pool_t *p_pool) {
+	POOL_flush(p_pool);
+
+	p_pool->is_in_use = 0;
+	MEMBARSTLD();
+}
+
+void *POOL_alloc(pool_t *p_pool, size_t size) {
+	int size_class;
+	pool_obj_t *p_obj;
+
+	size_class = (int)((size + POOL_CLASS_SIZE - 1) / POOL_CLASS_SIZE) - 1;
+	if (unlikely(size_class >= POOL_N_CLASSES)) {
+		printf("ERROR: pool object size [%lu] > [%d]\n", (unsigned long)size, POOL_MAX_OBJ_SIZE);
+		abort();
+	}
+
+	p_pool->stats.n_allocs++;
+
+	if (unlikely((p_pool->free_lists[size_class] == NULL) && (p_pool->p_remote_free != NULL))) {
+		POOL_drain_remote(p_pool);
+	}
+
+	p_obj = p_pool->free_lists[size_class];
+	if (likely(p_obj != NULL)) {
+		p_pool->free_lists[size_class] = p_obj->p_next;
+		return p_obj;
+	}
+
+	if (unlikely(p_pool->p_bump[size_class] + ((size_class + 1) * POOL_CLASS_SIZE) > p_pool->p_bump_end[size_class])) {
+		POOL_slab_alloc(p_pool, size_class);
+	}
+
+	p_obj = (pool_obj_t *)p_pool->p_bump[size_class];
+	p_pool->p_bump[size_class] += (size_class + 1) * POOL_CLASS_SIZE;
+
+	return p_obj;
+}
+
+void POOL_free(pool_t *p_pool, void *p_obj) {
+	pool_slab_t *p_slab;
+	pool_t *p_owner;
+	pool_remote_buffer_t *p_buf;
+	pool_obj_t *p_pobj = (pool_obj_t *)p_obj;
+
+	p_slab = POOL_slab_of(p_obj);
+	p_owner = p_slab->p_owner;
+
+	p_pool->stats.n_frees++;
+
+	if (likely(p_owner == p_pool)) {
+		p_pobj->p_next = p_pool->free_lists[p_slab->size_class];
+		p_pool->free_lists[p_slab->size_class] = p_pobj;
+		return;
+	}
+
+	p_pool->stats.n_remote_frees++;
+
+	p_buf = &(p_pool->remote_buffers[((uintptr_t)p_owner / sizeof(pool_t)) % POOL_REMOTE_BUFFERS]);
+	if (p_buf->p_owner != p_owner) {
+		POOL_remote_flush(p_pool, p_buf);
+		p_buf->p_owner = p_owner;
+	}
+
+	p_pobj->p_next = p_buf->p_first;
+	p_buf->p_first = p_pobj;
+	if (p_buf->p_last == NULL) {
+		p_buf->p_last = p_pobj;
+	}
+	p_buf->n_objs++;
+
+	if (p_buf->n_objs >= POOL_REMOTE_BATCH) {
+		POOL_remote_flush(p_pool, p_buf);
+	}
+
+}
+
+void POOL_flush(pool_t *p_pool) {
+	int i;
+
+	for (i = 0; i < POOL_REMOTE_BUFFERS; i++) {
+		POOL_remote_flush(p_pool, &(p_pool->remote_buffers[i]));
+	}
+
+}
+
+void POOL_print_stats() {
+	int i;
+	pool_stats_t stats;
+
+	memset(&stats, 0, sizeof(pool_stats_t));
+
+	for (i = 0; i < g_n_pools; i++) {
+		stats.n_allocs += g_pools[i]->stats.n_allocs;
+		stats.n_frees += g_pools[i]->stats.n_frees;
+		stats.n_remote_frees += g_pools[i]->stats.n_remote_frees;
+		stats.n_remote_flushes += g_pools[i]->stats.n_remote_flushes;
+		stats.n_slabs += g_pools[i]->stats.n_slabs;
+	}
+
+	printf("-------------------------------------------------\n");
+	printf("  Pool status:\n");
+	printf("    n_pools = %ld\n", (long)g_n_pools);
+	printf("    n_allocs = %lu\n", stats.n_allocs);
+	printf("    n_frees = %lu\n", stats.n_frees);
+	printf("    n_remote_frees = %lu\n", stats.n_remote_frees);
+	printf("    n_remote_flushes = %lu\n", stats.n_remote_flushes);
+	printf("    n_slabs = %lu (%lu KB)\n", stats.n_slabs, (stats.n_slabs * POOL_SLAB_SIZE) / 1024);
+	printf("-------------------------------------------------\n");
+}
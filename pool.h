@@ -0,0 +1,83 @@
+#ifndef POOL_H
+#define POOL_H 1
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define POOL_MAX_POOLS (256)
+
+#define POOL_CACHE_LINE (64)
+
+// Objects are rounded up to cache-line sized classes
+#define POOL_CLASS_SIZE (POOL_CACHE_LINE)
+#define POOL_N_CLASSES (16)
+#define POOL_MAX_OBJ_SIZE (POOL_CLASS_SIZE * POOL_N_CLASSES)
+
+// Slabs are aligned to their size, so an object finds its slab by masking
+#define POOL_SLAB_SIZE (64 * 1024)
+
+// Frees of objects owned by another pool are buffered, and handed back to
+// the owner in batches
+#define POOL_REMOTE_BUFFERS (8)
+#define POOL_REMOTE_BATCH (32)
+
+///////////////////////////////////////////////////////////////////////////////
+// TYPES
+///////////////////////////////////////////////////////////////////////////////
+typedef struct _pool_obj_t {
+	struct _pool_obj_t *p_next;
+} pool_obj_t;
+
+typedef struct _pool_remote_buffer_t {
+	struct _pool_t *p_owner;
+	pool_obj_t *p_first;
+	pool_obj_t *p_last;
+	int n_objs;
+} pool_remote_buffer_t;
+
+typedef struct _pool_stats_t {
+	long n_allocs;
+	long n_frees;
+	long n_remote_frees;
+	long n_remote_flushes;
+	long n_slabs;
+} pool_stats_t;
+
+typedef struct _pool_t {
+	volatile int64_t is_in_use;
+
+	// the NUMA node of the thread that created the pool
+	int node;
+
+	pool_obj_t *free_lists[POOL_N_CLASSES];
+	char *p_bump[POOL_N_CLASSES];
+	char *p_bump_end[POOL_N_CLASSES];
+
+	pool_remote_buffer_t remote_buffers[POOL_REMOTE_BUFFERS];
+
+	pool_stats_t stats;
+
+	// objects freed by other threads (lock-free stack)
+	pool_obj_t * volatile p_remote_free __attribute__((aligned(POOL_CACHE_LINE)));
+
+} __attribute__((aligned(POOL_CACHE_LINE))) pool_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// EXTERNAL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+pool_t *POOL_acquire();
+void POOL_release(pool_t *p_pool);
+
+void *POOL_alloc(pool_t *p_pool, size_t size);
+void POOL_free(pool_t *p_pool, void *p_obj);
+void POOL_flush(pool_t *p_pool);
+
+void POOL_print_stats();
+
+#endif // POOL_H
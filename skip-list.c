@@ -15,8 +15,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 // DEFINES
 ///////////////////////////////////////////////////////////////////////////////
-#define OP_ID_CONTAINS (0)
-#define OP_ID_INSERT (1)
+#define OP_ID_GET (0)
+#define OP_ID_PUT (1)
 #define OP_ID_REMOVE (2)
 
 #define SL_TRACE(format, ...) //printf(format, __VA_ARGS__)
@@ -44,13 +44,15 @@ static void sl_node_lock_slow_path(st_thread_t *self, volatile sl_node_t *p_node
 static void sl_node_lock(st_thread_t *self, volatile sl_node_t *p_node) {
 	SL_TRACE_IN_HTM("[%d] lock: %p\n", (int)self->uniq_id, p_node);
 	
-	if (unlikely(!self->is_htm_active)) {
+	// a software transaction cannot abort, so it takes the lock for real
+	if (unlikely((!self->is_htm_active) || (HTM_is_software()))) {
 		sl_node_lock_slow_path(self, p_node);
 		return;
 	}
 	
 	if (unlikely(p_node->lock != 0)) {
-		_xabort(123);
+		ST_LOCK_WAIT(self, &(p_node->lock));
+		HTM_abort_locked();
 	}
 
 	p_node->lock = 1;
@@ -69,19 +71,24 @@ static void sl_node_unlock(st_thread_t *self, volatile sl_node_t *p_node) {
 	
 }
 
-static int sl_randomLevel(int *p_seed)
+static int sl_randomLevel(int *p_seed, int max_level)
 {
 	int level = 1;
-	while (MY_RAND(p_seed) % 2 == 0 && level < SKIPLIST_MAX_LEVEL) {
+	while (MY_RAND(p_seed) % 2 == 0 && level < max_level) {
 		level++;
 	}
 	return level-1;
 }
 
-static volatile sl_node_t *sl_node_alloc() {
+static volatile sl_node_t *sl_node_alloc(st_thread_t *self, int height) {
 	volatile sl_node_t *p_node;
 	
-	p_node = (volatile sl_node_t *)malloc(sizeof(sl_node_t));
+	if (self == NULL) {
+		// the sentinels are never freed
+		p_node = (volatile sl_node_t *)malloc(SL_NODE_SIZE(height));
+	} else {
+		p_node = (volatile sl_node_t *)ST_alloc(self, SL_NODE_SIZE(height));
+	}
 	if (p_node == NULL) {
 		abort();
 	}
@@ -89,21 +96,28 @@ static volatile sl_node_t *sl_node_alloc() {
 	return p_node;
 }
 
-static void sl_node_init(st_thread_t *self, volatile sl_node_t *p_node, int key, int height) {
+// Returns NULL when preallocation is disabled
+static volatile sl_node_t *sl_node_reserve(st_thread_t *self, int height) {
+	return (volatile sl_node_t *)ST_prealloc_reserve(self, SL_NODE_SIZE(height));
+}
+
+static void sl_node_init(st_thread_t *self, volatile sl_node_t *p_node, sl_key_t key, sl_value_t value, int height) {
 	p_node->key = key;
+	p_node->value = value;
 	p_node->topLevel = height;
 	p_node->lock = 0;
 	p_node->marked = 0;
 	p_node->fullyLinked = 0;
+	p_node->birth_era = 0;
 	
 	if (self != NULL) {
-		SL_TRACE_IN_HTM("[%d] sl_node_init: key = %d, height = %d\n", (int)self->uniq_id, key, height);
+		SL_TRACE_IN_HTM("[%d] sl_node_init: key = %lu, height = %d\n", (int)self->uniq_id, (unsigned long)key, height);
 	}
 	
 }
 
 static int sl_find_pure(st_thread_t *self, 
-				        skiplist_t *p_skiplist, int key, 
+				        skiplist_t *p_skiplist, sl_key_t key, 
 				        volatile sl_node_t **p_preds, volatile sl_node_t **p_succs)
 {
 	int n_restarts;
@@ -130,7 +144,7 @@ restart:
 		goto restart;
 	}
 	
-	for (level = SKIPLIST_MAX_LEVEL-1; level >= 0; level--) {
+	for (level = p_skiplist->max_level-1; level >= 0; level--) {
 		
 		p_curr = p_pred->p_next[level];
 		if ((p_curr == NULL) || (p_curr->marked)) {
@@ -145,7 +159,7 @@ restart:
 			}
 		}
 	
-		if (l_found == -1 && key == p_curr->key) {
+		if (l_found == -1 && key == p_curr->key && p_curr != p_skiplist->p_tail) {
 			l_found = level;
 		}
 		
@@ -157,8 +171,64 @@ restart:
 	return l_found;
 }
 
+// The head is a sentinel, so only the links are read under the reservation
+static int sl_find_ibr(st_thread_t *self, 
+				        skiplist_t *p_skiplist, sl_key_t key, 
+				        volatile sl_node_t **p_preds, volatile sl_node_t **p_succs)
+{
+	int n_restarts = 0;
+	int level;
+	int l_found = -1;
+	volatile sl_node_t *p_pred = NULL;
+	volatile sl_node_t *p_curr = NULL;
+
+restart:
+	n_restarts++;
+	if (n_restarts > 1000) {
+		//printf("restarts! [%d] ", n_restarts);
+		n_restarts = 0;
+	}
+
+	l_found = -1;
+	p_pred = NULL;
+	p_curr = NULL;
+	
+	SL_TRACE_IN_HTM("[%d] sl_find_ibr: start\n", (int)self->uniq_id);
+	
+	p_pred = p_skiplist->p_head;
+	if ((p_pred == NULL) || (p_pred->marked)) {
+		goto restart;
+	}
+	
+	for (level = p_skiplist->max_level-1; level >= 0; level--) {
+		
+		ST_IBR_READ(self, p_curr, &(p_pred->p_next[level]));
+		if ((p_curr == NULL) || (p_curr->marked)) {
+			goto restart;
+		}
+		
+		while (key > p_curr->key) {
+			p_pred = p_curr;
+			ST_IBR_READ(self, p_curr, &(p_pred->p_next[level]));
+			if ((p_curr == NULL) || (p_curr->marked)) {
+				goto restart;
+			}
+		}
+	
+		if (l_found == -1 && key == p_curr->key && p_curr != p_skiplist->p_tail) {
+			l_found = level;
+		}
+		
+		p_preds[level] = p_pred;
+		p_succs[level] = p_curr;
+	}
+	
+	SL_TRACE_IN_HTM("[%d] sl_find_ibr: finish\n", (int)self->uniq_id);
+	return l_found;
+}
+
 static int sl_find_hp(st_thread_t *self, 
-					  skiplist_t *p_skiplist, int key, 
+					  skiplist_t *p_skiplist, sl_key_t key, 
 					  volatile sl_node_t **p_preds, volatile sl_node_t **p_succs, 
 					  volatile st_hp_record_t **hp_preds, volatile st_hp_record_t **hp_succs)
 {
@@ -199,7 +269,7 @@ restart:
 		goto restart;
 	}
 	
-	for (level = SKIPLIST_MAX_LEVEL-1; level >= 0; level--) {
+	for (level = p_skiplist->max_level-1; level >= 0; level--) {
 		
 		ST_HP_INIT(self, hp_curr, &(p_pred->p_next[level]));
 		p_curr = p_pred->p_next[level];
@@ -223,7 +293,7 @@ restart:
 			}
 		}
 	
-		if (l_found == -1 && key == p_curr->key) {
+		if (l_found == -1 && key == p_curr->key && p_curr != p_skiplist->p_tail) {
 			l_found = level;
 		}
 		
@@ -245,7 +315,7 @@ restart:
 }
 
 static int sl_find_stacktrack(st_thread_t *self, 
-							   skiplist_t *p_skiplist, int key, 
+							   skiplist_t *p_skiplist, sl_key_t key, 
 							   volatile sl_node_t **p_preds, volatile sl_node_t **p_succs, 
 							   volatile st_hp_record_t **hp_preds, volatile st_hp_record_t **hp_succs)
 {
@@ -294,7 +364,7 @@ restart:
 		goto restart;
 	}
 	
-	for (level = SKIPLIST_MAX_LEVEL-1; level >= 0; level--) {
+	for (level = p_skiplist->max_level-1; level >= 0; level--) {
 		ST_SPLIT(self);
 		
 		ST_HP_INIT(self, hp_curr, &(p_pred->p_next[level]));
@@ -323,7 +393,7 @@ restart:
 
 		}
 	
-		if (l_found == -1 && key == p_curr->key) {
+		if (l_found == -1 && key == p_curr->key && p_curr != p_skiplist->p_tail) {
 			ST_SPLIT(self);
 			l_found = level;
 		}
@@ -348,44 +418,175 @@ restart:
 	return l_found;
 }
 
+// Unlinks the node of the key, and returns it in pp_victim. Shared by the 
+// protocols that do not protect the traversal (pure, EBR).
+static int sl_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value, volatile sl_node_t **pp_victim) {
+	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile sl_node_t *p_victim = NULL;
+	volatile sl_node_t *p_pred = NULL;
+	int i;
+	int level;
+	int lFound;
+	int highestLocked;
+	int valid;
+	int isMarked = 0;
+	int topLevel = -1;
+	int ret = 0;
+
+	while (1) {
+		
+		lFound = sl_find_pure(self, p_skiplist, key, p_preds, p_succs);
+		
+		if (lFound == -1) {
+			break;
+		}
+		
+		SL_TRACE_IN_HTM("[%d] sl_remove_pure: find res = %d\n", (int)self->uniq_id, lFound);
+		p_victim = p_succs[lFound];
+		
+		if ((!isMarked) ||
+			(p_victim->fullyLinked && p_victim->topLevel == lFound && !p_victim->marked)) 
+		{
+			if (!isMarked) {
+				topLevel = p_victim->topLevel;
+				sl_node_lock(self, p_victim);
+				if (p_victim->marked) {
+					sl_node_unlock(self, p_victim);
+					ret = 0;
+					break;
+				}
+				
+				p_victim->marked = 1;
+				isMarked = 1;
+				
+			}
+			
+			highestLocked = -1;
+			valid = 1;
+
+			for (level = 0; valid && (level <= topLevel); level++)
+			{
+				p_pred = p_preds[level];
+				if (level == 0 || p_preds[level] != p_preds[level - 1]) { // don't do twice
+					sl_node_lock(self, p_pred);
+				}
+				highestLocked = level;
+				valid = !p_pred->marked && p_pred->p_next[level] == p_victim;
+				if (!valid) {
+					SL_TRACE_IN_HTM("[%d] sl_remove_pure: not valid [p_pred->marked = %d]\n", (int)self->uniq_id, p_pred->marked);
+				}
+			}
+			
+			
+			
+			if (valid) {
+				for (level = topLevel; level >= 0; level--) {
+					p_preds[level]->p_next[level] = p_victim->p_next[level];
+					p_victim->p_next[level] = NULL;
+				}
+				sl_node_unlock(self, p_victim);
+				ret = 1;
+				if (p_value != NULL) {
+					*p_value = p_victim->value;
+				}
+				
+			} else {
+				p_victim->marked = 0;
+				isMarked = 0;
+				sl_node_unlock(self, p_victim);
+				
+			}
+			
+			// unlock mutexes
+			for (i = 0; i <= highestLocked; i++) {
+				if (i == 0 || p_preds[i] != p_preds[i - 1]) {
+					sl_node_unlock(self, p_preds[i]);
+				}
+			}
+			
+			if (valid) {
+				break;
+			}
+		}
+
+	}
+
+	if (ret == 1) {
+		*pp_victim = p_victim;
+	}
+
+	return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // EXTERNAL FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////
 
-skiplist_t *skiplist_init() {
+// A level halves the nodes, so log2(expected_size) levels keep the 
+// search depth logarithmic
+skiplist_t *skiplist_init(long expected_size) {
 	int i;
+	int max_level;
 	
 	skiplist_t *p_skiplist = malloc(sizeof(skiplist_t));
 	
-	p_skiplist->p_head = sl_node_alloc();
-	sl_node_init(NULL, p_skiplist->p_head, MIN_KEY, SKIPLIST_MAX_LEVEL-1);
+	max_level = SKIPLIST_MIN_LEVEL;
+	while ((max_level < SKIPLIST_MAX_LEVEL) && ((1L << max_level) < expected_size)) {
+		max_level++;
+	}
+	p_skiplist->max_level = max_level;
+	
+	p_skiplist->p_head = sl_node_alloc(NULL, max_level-1);
+	sl_node_init(NULL, p_skiplist->p_head, MIN_KEY, 0, max_level-1);
 	
-	p_skiplist->p_tail = sl_node_alloc();
-	sl_node_init(NULL, p_skiplist->p_tail, MAX_KEY, SKIPLIST_MAX_LEVEL-1);
+	p_skiplist->p_tail = sl_node_alloc(NULL, max_level-1);
+	sl_node_init(NULL, p_skiplist->p_tail, MAX_KEY, 0, max_level-1);
 	
-	for (i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+	for (i = 0; i < max_level; i++) {
 		p_skiplist->p_head->p_next[i] = p_skiplist->p_tail;
+		p_skiplist->p_tail->p_next[i] = NULL;
 	}
 	
 	return p_skiplist;
 }
 
-int skiplist_contains_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+void skiplist_destroy(st_thread_t *self, skiplist_t *p_skiplist) {
+	volatile sl_node_t *p_node;
+	volatile sl_node_t *p_next;
+	
+	p_node = p_skiplist->p_head->p_next[0];
+	
+	while (p_node != p_skiplist->p_tail) {
+		p_next = p_node->p_next[0];
+		ST_dealloc(self, (void *)p_node);
+		p_node = p_next;
+	}
+	
+	free((void *)p_skiplist->p_head);
+	free((void *)p_skiplist->p_tail);
+	free(p_skiplist);
+}
+
+int skiplist_get_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	int lFound;
 	int ret;
 
-	SL_TRACE("[%d] skiplist_contains_pure: start\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_pure: start\n", (int)self->uniq_id);
 
 	lFound = sl_find_pure(self, p_skiplist, key, p_preds, p_succs);
 	ret = (lFound != -1) && (p_succs[lFound]->fullyLinked) && (!p_succs[lFound]->marked);
+	if (ret && (p_value != NULL)) {
+		*p_value = p_succs[lFound]->value;
+	}
     
-	SL_TRACE("[%d] skiplist_contains_pure: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_pure: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-int skiplist_contains_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_get_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
 	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
@@ -393,20 +594,23 @@ int skiplist_contains_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 	int lFound;
 	int ret;
 
-	SL_TRACE("[%d] skiplist_contains_hp: start\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_hp: start\n", (int)self->uniq_id);
 
 	ST_init(self);
 	
 	lFound = sl_find_hp(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 	ret = (lFound != -1) && (p_succs[lFound]->fullyLinked) && (!p_succs[lFound]->marked);
+	if (ret && (p_value != NULL)) {
+		*p_value = p_succs[lFound]->value;
+	}
     
 	ST_finish(self);
 	
-	SL_TRACE("[%d] skiplist_contains_hp: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_hp: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-int skiplist_contains_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_get_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
 	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
@@ -414,19 +618,22 @@ int skiplist_contains_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int
 	int lFound;
 	int ret;
 
-	SL_TRACE("[%d] skiplist_contains_stacktrack: start\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_stacktrack: start\n", (int)self->uniq_id);
 
 	ST_init(self);
 	
 	ST_stack_init(self);
-	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
-	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
+	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * p_skiplist->max_level);
+	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * p_skiplist->max_level);
 	ST_stack_publish(self);
 	
-	ST_split_start(self, OP_ID_CONTAINS);
+	ST_split_start(self, OP_ID_GET);
 	
 	lFound = sl_find_stacktrack(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 	ret = (lFound != -1) && (p_succs[lFound]->fullyLinked) && (!p_succs[lFound]->marked);
+	if (ret && (p_value != NULL)) {
+		*p_value = p_succs[lFound]->value;
+	}
     
 	ST_split_finish(self);
 	
@@ -434,39 +641,81 @@ int skiplist_contains_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int
 	
 	ST_finish(self);	
 	
-	SL_TRACE("[%d] skiplist_contains_stacktrack: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_get_stacktrack: finish\n", (int)self->uniq_id);
+	return ret;
+}
+
+int skiplist_get_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
+	int ret;
+
+	ST_EBR_enter(self);
+	ret = skiplist_get_pure(self, p_skiplist, key, p_value);
+	ST_EBR_exit(self);
+
+	return ret;
+}
+
+int skiplist_get_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
+	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
+	int lFound;
+	int ret;
+
+	SL_TRACE("[%d] skiplist_get_ibr: start\n", (int)self->uniq_id);
+
+	ST_IBR_start(self);
+	
+	lFound = sl_find_ibr(self, p_skiplist, key, p_preds, p_succs);
+	ret = (lFound != -1) && (p_succs[lFound]->fullyLinked) && (!p_succs[lFound]->marked);
+	if (ret && (p_value != NULL)) {
+		*p_value = p_succs[lFound]->value;
+	}
+	
+	ST_IBR_finish(self);
+    
+	SL_TRACE("[%d] skiplist_get_ibr: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-volatile sl_node_t *skiplist_insert_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_put_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value) {
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_node_found = NULL;
 	volatile sl_node_t *p_pred = NULL;
 	volatile sl_node_t *p_succ = NULL;
 	volatile sl_node_t *p_new_node = NULL;
-	volatile sl_node_t *ret = NULL;
+	int ret = 0;
 	int level;
 	int topLevel = -1;
 	int lFound = -1;
 	int done = 0;
 			
-	SL_TRACE("[%d] skiplist_insert_pure: start [ key = %d ]\n", (int)self->uniq_id, key);
+	SL_TRACE("[%d] skiplist_put_pure: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
 	
-	topLevel = sl_randomLevel(self->p_seed);
+	topLevel = sl_randomLevel(self->p_seed, p_skiplist->max_level);
 	
 	while (!done) {		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_pure: find\n", (int)self->uniq_id);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_pure: find\n", (int)self->uniq_id);
 		
 		lFound = sl_find_pure(self, p_skiplist, key, p_preds, p_succs);
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_pure: find res=%d\n", (int)self->uniq_id, lFound);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_pure: find res=%d\n", (int)self->uniq_id, lFound);
 		
 		if (lFound != -1) {
 			p_node_found = p_succs[lFound];
 			if (!(p_node_found->marked)) {
 				while (!(p_node_found->fullyLinked)) { CPU_RELAX; } // keep spinning
-				return ret;
+				// a remove marks under the node lock, so it cannot lose this update
+				sl_node_lock(self, p_node_found);
+				if (!(p_node_found->marked)) {
+					if (p_old_value != NULL) {
+						*p_old_value = p_node_found->value;
+					}
+					p_node_found->value = value;
+					sl_node_unlock(self, p_node_found);
+					return ret;
+				}
+				sl_node_unlock(self, p_node_found);
 			}
 			continue; // try again
 		}
@@ -488,12 +737,12 @@ volatile sl_node_t *skiplist_insert_pure(st_thread_t *self, skiplist_t *p_skipli
 			valid = !p_pred->marked && !p_succ->marked && p_pred->p_next[level] == p_succ;
 		}
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_pure: valid=%d\n", (int)self->uniq_id, valid);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_pure: valid=%d\n", (int)self->uniq_id, valid);
 		
 		if (valid) {
-			p_new_node = sl_node_alloc();
-			sl_node_init(self, p_new_node, key, topLevel);
-			ret = p_new_node;
+			p_new_node = sl_node_alloc(self, topLevel);
+			sl_node_init(self, p_new_node, key, value, topLevel);
+			ret = 1;
 			p_new_node->topLevel = topLevel;
 			for (level = 0; level <= topLevel; level++) {
 				p_new_node->p_next[level] = p_succs[level];
@@ -512,11 +761,11 @@ volatile sl_node_t *skiplist_insert_pure(st_thread_t *self, skiplist_t *p_skipli
 		}
 	}
 		
-	SL_TRACE("[%d] skiplist_insert_pure: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_put_pure: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_put_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value) {
 	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
@@ -525,15 +774,15 @@ volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist
 	volatile sl_node_t *p_pred = NULL;
 	volatile sl_node_t *p_succ = NULL;
 	volatile sl_node_t *p_new_node = NULL;
-	volatile sl_node_t *ret = NULL;
+	int ret = 0;
 	int level;
 	int topLevel;
 	int lFound;
 	int done = 0;
 			
-	SL_TRACE("[%d] skiplist_insert_hp: start\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_put_hp: start\n", (int)self->uniq_id);
 	
-	topLevel = sl_randomLevel(self->p_seed);
+	topLevel = sl_randomLevel(self->p_seed, p_skiplist->max_level);
 	
 	ST_init(self);
 
@@ -541,17 +790,28 @@ volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist
 		
 		ST_HP_reset(self);
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_hp: find\n", (int)self->uniq_id);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_hp: find\n", (int)self->uniq_id);
 		
 		lFound = sl_find_hp(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_hp: find res=%d\n", (int)self->uniq_id, lFound);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_hp: find res=%d\n", (int)self->uniq_id, lFound);
 		
 		if (lFound != -1) {
 			p_node_found = p_succs[lFound];
 			if (!(p_node_found->marked)) {
 				while (!(p_node_found->fullyLinked)) { CPU_RELAX; } // keep spinning
-				return ret;
+				// a remove marks under the node lock, so it cannot lose this update
+				sl_node_lock(self, p_node_found);
+				if (!(p_node_found->marked)) {
+					if (p_old_value != NULL) {
+						*p_old_value = p_node_found->value;
+					}
+					p_node_found->value = value;
+					sl_node_unlock(self, p_node_found);
+					ST_finish(self);
+					return ret;
+				}
+				sl_node_unlock(self, p_node_found);
 			}
 			continue; // try again
 		}
@@ -573,12 +833,12 @@ volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist
 			valid = !p_pred->marked && !p_succ->marked && p_pred->p_next[level] == p_succ;
 		}
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_hp: valid=%d\n", (int)self->uniq_id, valid);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_hp: valid=%d\n", (int)self->uniq_id, valid);
 		
 		if (valid) {
-			p_new_node = sl_node_alloc();
-			sl_node_init(self, p_new_node, key, topLevel);
-			ret = p_new_node;
+			p_new_node = sl_node_alloc(self, topLevel);
+			sl_node_init(self, p_new_node, key, value, topLevel);
+			ret = 1;
 			p_new_node->topLevel = topLevel;
 			for (level = 0; level <= topLevel; level++) {
 				p_new_node->p_next[level] = p_succs[level];
@@ -599,11 +859,11 @@ volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist
 	
 	ST_finish(self);
 	
-	SL_TRACE("[%d] skiplist_insert_hp: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_put_hp: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_put_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value) {
 	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
@@ -612,39 +872,43 @@ volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_
 	volatile sl_node_t *p_pred = NULL;
 	volatile sl_node_t *p_succ = NULL;
 	volatile sl_node_t *p_new_node = NULL;
-	volatile sl_node_t *ret = NULL;
+	volatile sl_node_t *p_reserved = NULL;
+	int ret = 0;
 	int level;
 	int topLevel = -1;
 	int lFound = -1;
 	int done = 0;
 			
-	SL_TRACE("[%d] skiplist_insert_stacktrack: start [ key = %d ]\n", (int)self->uniq_id, key);
+	SL_TRACE("[%d] skiplist_put_stacktrack: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
 	
 	ST_init(self);
 	
 	ST_stack_init(self);
-	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
-	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
+	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * p_skiplist->max_level);
+	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * p_skiplist->max_level);
 	ST_stack_add_range(self, (char *)&p_node_found, sizeof(sl_node_t *));
 	ST_stack_add_range(self, (char *)&p_pred, sizeof(sl_node_t *));
 	ST_stack_add_range(self, (char *)&p_succ, sizeof(sl_node_t *));
 	ST_stack_add_range(self, (char *)&p_new_node, sizeof(sl_node_t *));
 	ST_stack_publish(self);
 	
-	topLevel = sl_randomLevel(self->p_seed);
+	topLevel = sl_randomLevel(self->p_seed, p_skiplist->max_level);
+	
+	// allocate before entering HTM
+	p_reserved = sl_node_reserve(self, topLevel);
 	
-	ST_split_start(self, OP_ID_INSERT);
+	ST_split_start(self, OP_ID_PUT);
 	
 	while (!done) {
 		ST_SPLIT(self);
 		
 		ST_HP_reset(self);
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_stacktrack: find\n", (int)self->uniq_id);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_stacktrack: find\n", (int)self->uniq_id);
 		
 		lFound = sl_find_stacktrack(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_stacktrack: find res=%d\n", (int)self->uniq_id, lFound);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_stacktrack: find res=%d\n", (int)self->uniq_id, lFound);
 		
 		if (lFound != -1) {
 			ST_SPLIT(self);
@@ -652,9 +916,20 @@ volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_
 			if (!(p_node_found->marked)) {
 				ST_SPLIT(self);
 				while (!(p_node_found->fullyLinked)) { CPU_RELAX; } // keep spinning
-				ST_split_finish(self);
-				ST_finish(self);
-				return ret;
+				// a remove marks under the node lock, so it cannot lose this update
+				sl_node_lock(self, p_node_found);
+				if (!(p_node_found->marked)) {
+					if (p_old_value != NULL) {
+						*p_old_value = p_node_found->value;
+					}
+					p_node_found->value = value;
+					sl_node_unlock(self, p_node_found);
+					ST_split_finish(self);
+					ST_stack_del(self);
+					ST_finish(self);
+					return ret;
+				}
+				sl_node_unlock(self, p_node_found);
 			}
 			continue; // try again
 		}
@@ -679,13 +954,18 @@ volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_
 			valid = !p_pred->marked && !p_succ->marked && p_pred->p_next[level] == p_succ;
 		}
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_insert_stacktrack: valid=%d\n", (int)self->uniq_id, valid);
+		SL_TRACE_IN_HTM("[%d] skiplist_put_stacktrack: valid=%d\n", (int)self->uniq_id, valid);
 		
 		if (valid) {
 			ST_SPLIT(self);
-			p_new_node = sl_node_alloc();
-			sl_node_init(self, p_new_node, key, topLevel);
-			ret = p_new_node;
+			if (p_reserved != NULL) {
+				p_new_node = p_reserved;
+				ST_prealloc_take(self);
+			} else {
+				p_new_node = sl_node_alloc(self, topLevel);
+			}
+			sl_node_init(self, p_new_node, key, value, topLevel);
+			ret = 1;
 			p_new_node->topLevel = topLevel;
 			for (level = 0; level <= topLevel; level++) {
 				ST_SPLIT(self);
@@ -713,11 +993,134 @@ volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_
 
 	ST_finish(self);
 	
-	SL_TRACE("[%d] skiplist_insert_stacktrack: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_put_stacktrack: finish\n", (int)self->uniq_id);
+	return ret;
+}
+
+int skiplist_put_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value) {
+	int ret;
+
+	ST_EBR_enter(self);
+	ret = skiplist_put_pure(self, p_skiplist, key, value, p_old_value);
+	ST_EBR_exit(self);
+
+	return ret;
+}
+
+int skiplist_put_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value) {
+	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile sl_node_t *p_node_found = NULL;
+	volatile sl_node_t *p_pred = NULL;
+	volatile sl_node_t *p_succ = NULL;
+	volatile sl_node_t *p_new_node = NULL;
+	int ret = 0;
+	int level;
+	int topLevel = -1;
+	int lFound = -1;
+	int done = 0;
+			
+	SL_TRACE("[%d] skiplist_put_ibr: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
+	
+	topLevel = sl_randomLevel(self->p_seed, p_skiplist->max_level);
+	
+	ST_IBR_start(self);
+	
+	while (!done) {		
+		SL_TRACE_IN_HTM("[%d] skiplist_put_ibr: find\n", (int)self->uniq_id);
+		
+		lFound = sl_find_ibr(self, p_skiplist, key, p_preds, p_succs);
+		
+		SL_TRACE_IN_HTM("[%d] skiplist_put_ibr: find res=%d\n", (int)self->uniq_id, lFound);
+		
+		if (lFound != -1) {
+			p_node_found = p_succs[lFound];
+			if (!(p_node_found->marked)) {
+				while (!(p_node_found->fullyLinked)) { CPU_RELAX; } // keep spinning
+				// a remove marks under the node lock, so it cannot lose this update
+				sl_node_lock(self, p_node_found);
+				if (!(p_node_found->marked)) {
+					if (p_old_value != NULL) {
+						*p_old_value = p_node_found->value;
+					}
+					p_node_found->value = value;
+					sl_node_unlock(self, p_node_found);
+					ST_IBR_finish(self);
+					return ret;
+				}
+				sl_node_unlock(self, p_node_found);
+			}
+			continue; // try again
+		}
+
+		int highestLocked = -1;
+		
+		int valid = 1;
+		for (level = 0; valid && (level <= topLevel); level++)
+		{	
+			p_pred = p_preds[level];
+			p_succ = p_succs[level];
+			if (level == 0 || p_preds[level] != p_preds[level - 1]) { 
+				// don't try to lock same node twice
+				sl_node_lock(self, p_pred);
+			}
+			highestLocked = level;
+
+			// make sure nothing has changed in between
+			valid = !p_pred->marked && !p_succ->marked && p_pred->p_next[level] == p_succ;
+		}
+		
+		SL_TRACE_IN_HTM("[%d] skiplist_put_ibr: valid=%d\n", (int)self->uniq_id, valid);
+		
+		if (valid) {
+			p_new_node = sl_node_alloc(self, topLevel);
+			sl_node_init(self, p_new_node, key, value, topLevel);
+			p_new_node->birth_era = ST_IBR_alloc_era(self);
+			ret = 1;
+			p_new_node->topLevel = topLevel;
+			for (level = 0; level <= topLevel; level++) {
+				p_new_node->p_next[level] = p_succs[level];
+				p_preds[level]->p_next[level] = p_new_node;
+			}
+			p_new_node->fullyLinked = 1;
+			done = 1;
+		}
+
+		// unlock everything here
+		for (level = 0; level <= highestLocked; level++) {
+			if (level == 0 || p_preds[level] != p_preds[level - 1]) {
+				// don't try to unlock the same node twice
+				sl_node_unlock(self, p_preds[level]);
+			}
+		}
+	}
+	
+	ST_IBR_finish(self);
+		
+	SL_TRACE("[%d] skiplist_put_ibr: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
+	volatile sl_node_t *p_victim = NULL;
+	int ret;
+
+	SL_TRACE("[%d] skiplist_remove_pure: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
+	
+	ret = sl_remove_pure(self, p_skiplist, key, p_value, &p_victim);
+
+	// the victim is never freed
+	if (ret == 1) {
+		ST_leak(self);
+	}
+
+	SL_TRACE("[%d] skiplist_remove_pure: finish\n", (int)self->uniq_id);
+	return ret;
+}
+
+int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
+	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
+	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_victim = NULL;
@@ -731,17 +1134,20 @@ int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 	int topLevel = -1;
 	int ret = 0;
 
-	SL_TRACE("[%d] skiplist_remove_pure: start [ key = %d ]\n", (int)self->uniq_id, key);
-		
+	SL_TRACE("[%d] skiplist_remove_hp: start\n", (int)self->uniq_id);
+	
+	ST_init(self);
+	
 	while (1) {
 		
-		lFound = sl_find_pure(self, p_skiplist, key, p_preds, p_succs);
+		ST_HP_reset(self);
+		
+		lFound = sl_find_hp(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 		
 		if (lFound == -1) {
 			break;
 		}
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_remove_pure: find res = %d\n", (int)self->uniq_id, lFound);
 		p_victim = p_succs[lFound];
 		
 		if ((!isMarked) ||
@@ -758,6 +1164,7 @@ int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 				
 				p_victim->marked = 1;
 				isMarked = 1;
+				MEMBARSTLD();
 				
 			}
 			
@@ -772,13 +1179,8 @@ int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 				}
 				highestLocked = level;
 				valid = !p_pred->marked && p_pred->p_next[level] == p_victim;
-				if (!valid) {
-					SL_TRACE_IN_HTM("[%d] skiplist_remove_pure: not valid [p_pred->marked = %d]\n", (int)self->uniq_id, p_pred->marked);
-				}
 			}
-			
-			
-			
+
 			if (valid) {
 				for (level = topLevel; level >= 0; level--) {
 					p_preds[level]->p_next[level] = p_victim->p_next[level];
@@ -786,12 +1188,13 @@ int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 				}
 				sl_node_unlock(self, p_victim);
 				ret = 1;
-				
+				if (p_value != NULL) {
+					*p_value = p_victim->value;
+				}
 			} else {
 				p_victim->marked = 0;
 				isMarked = 0;
 				sl_node_unlock(self, p_victim);
-				
 			}
 			
 			// unlock mutexes
@@ -808,11 +1211,17 @@ int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 
 	}
 
-	SL_TRACE("[%d] skiplist_remove_pure: finish\n", (int)self->uniq_id);
+	ST_finish(self);
+	
+	if (ret == 1) {
+		ST_free(self, (int64_t *)p_victim);
+	}
+
+	SL_TRACE("[%d] skiplist_remove_hp: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
+int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
 	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
@@ -828,29 +1237,44 @@ int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 	int topLevel = -1;
 	int ret = 0;
 
-	SL_TRACE("[%d] skiplist_remove_hp: start\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_remove_stacktrack: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
 	
 	ST_init(self);
 	
+	ST_stack_init(self);
+	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * p_skiplist->max_level);
+	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * p_skiplist->max_level);
+	ST_stack_add_range(self, (char *)&p_victim, sizeof(sl_node_t *));
+	ST_stack_add_range(self, (char *)&p_pred, sizeof(sl_node_t *));
+	ST_stack_publish(self);
+	
+	ST_split_start(self, OP_ID_REMOVE);
+	
 	while (1) {
+		ST_SPLIT(self);
 		
 		ST_HP_reset(self);
 		
-		lFound = sl_find_hp(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
+		lFound = sl_find_stacktrack(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
 		
 		if (lFound == -1) {
+			ST_SPLIT(self);
 			break;
 		}
 		
+		SL_TRACE_IN_HTM("[%d] skiplist_remove_stacktrack: find res = %d\n", (int)self->uniq_id, lFound);
 		p_victim = p_succs[lFound];
 		
 		if ((!isMarked) ||
 			(p_victim->fullyLinked && p_victim->topLevel == lFound && !p_victim->marked)) 
 		{
+			ST_SPLIT(self);
 			if (!isMarked) {
+				ST_SPLIT(self);
 				topLevel = p_victim->topLevel;
 				sl_node_lock(self, p_victim);
 				if (p_victim->marked) {
+					ST_SPLIT(self);
 					sl_node_unlock(self, p_victim);
 					ret = 0;
 					break;
@@ -858,7 +1282,6 @@ int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 				
 				p_victim->marked = 1;
 				isMarked = 1;
-				MEMBARSTLD();
 				
 			}
 			
@@ -867,54 +1290,91 @@ int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, int key) {
 
 			for (level = 0; valid && (level <= topLevel); level++)
 			{
+				ST_SPLIT(self);
 				p_pred = p_preds[level];
 				if (level == 0 || p_preds[level] != p_preds[level - 1]) { // don't do twice
+					ST_SPLIT(self);
 					sl_node_lock(self, p_pred);
 				}
 				highestLocked = level;
 				valid = !p_pred->marked && p_pred->p_next[level] == p_victim;
+				if (!valid) {
+					SL_TRACE_IN_HTM("[%d] skiplist_remove_stacktrack: not valid [p_pred->marked = %d]\n", (int)self->uniq_id, p_pred->marked);
+				}
 			}
-
+			
 			if (valid) {
+				ST_SPLIT(self);
 				for (level = topLevel; level >= 0; level--) {
+					ST_SPLIT(self);
 					p_preds[level]->p_next[level] = p_victim->p_next[level];
 					p_victim->p_next[level] = NULL;
 				}
 				sl_node_unlock(self, p_victim);
 				ret = 1;
+				if (p_value != NULL) {
+					*p_value = p_victim->value;
+				}
+				
 			} else {
+				ST_SPLIT(self);
 				p_victim->marked = 0;
 				isMarked = 0;
 				sl_node_unlock(self, p_victim);
+				
 			}
 			
 			// unlock mutexes
 			for (i = 0; i <= highestLocked; i++) {
+				ST_SPLIT(self);
 				if (i == 0 || p_preds[i] != p_preds[i - 1]) {
+					ST_SPLIT(self);
 					sl_node_unlock(self, p_preds[i]);
 				}
 			}
 			
 			if (valid) {
+				ST_SPLIT(self);
 				break;
 			}
 		}
 
 	}
 
+	ST_split_finish(self);
+	
+	ST_stack_del(self);
+	
 	ST_finish(self);
 	
 	if (ret == 1) {
+		SL_TRACE("[%d] skiplist_remove_stacktrack: ST_FREE p_victim = %p\n", (int)self->uniq_id, p_victim);
 		ST_free(self, (int64_t *)p_victim);
 	}
 
-	SL_TRACE("[%d] skiplist_remove_hp: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_remove_stacktrack: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
-int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key) {
-	volatile st_hp_record_t *hp_preds[SKIPLIST_MAX_LEVEL] = {0,};
-	volatile st_hp_record_t *hp_succs[SKIPLIST_MAX_LEVEL] = {0,};
+int skiplist_remove_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
+	volatile sl_node_t *p_victim = NULL;
+	int ret;
+
+	SL_TRACE("[%d] skiplist_remove_ebr: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
+
+	ST_EBR_enter(self);
+	ret = sl_remove_pure(self, p_skiplist, key, p_value, &p_victim);
+	ST_EBR_exit(self);
+
+	if (ret == 1) {
+		ST_EBR_retire(self, (int64_t *)p_victim);
+	}
+
+	SL_TRACE("[%d] skiplist_remove_ebr: finish\n", (int)self->uniq_id);
+	return ret;
+}
+
+int skiplist_remove_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value) {
 	volatile sl_node_t *p_preds[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_succs[SKIPLIST_MAX_LEVEL] = {0,};
 	volatile sl_node_t *p_victim = NULL;
@@ -928,44 +1388,28 @@ int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int ke
 	int topLevel = -1;
 	int ret = 0;
 
-	SL_TRACE("[%d] skiplist_remove_stacktrack: start [ key = %d ]\n", (int)self->uniq_id, key);
+	SL_TRACE("[%d] skiplist_remove_ibr: start [ key = %lu ]\n", (int)self->uniq_id, (unsigned long)key);
 	
-	ST_init(self);
-	
-	ST_stack_init(self);
-	ST_stack_add_range(self, (char *)p_preds, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
-	ST_stack_add_range(self, (char *)p_succs, sizeof(sl_node_t *) * SKIPLIST_MAX_LEVEL);
-	ST_stack_add_range(self, (char *)&p_victim, sizeof(sl_node_t *));
-	ST_stack_add_range(self, (char *)&p_pred, sizeof(sl_node_t *));
-	ST_stack_publish(self);
-	
-	ST_split_start(self, OP_ID_REMOVE);
+	ST_IBR_start(self);
 	
 	while (1) {
-		ST_SPLIT(self);
 		
-		ST_HP_reset(self);
-		
-		lFound = sl_find_stacktrack(self, p_skiplist, key, p_preds, p_succs, hp_preds, hp_succs);
+		lFound = sl_find_ibr(self, p_skiplist, key, p_preds, p_succs);
 		
 		if (lFound == -1) {
-			ST_SPLIT(self);
 			break;
 		}
 		
-		SL_TRACE_IN_HTM("[%d] skiplist_remove_stacktrack: find res = %d\n", (int)self->uniq_id, lFound);
+		SL_TRACE_IN_HTM("[%d] skiplist_remove_ibr: find res = %d\n", (int)self->uniq_id, lFound);
 		p_victim = p_succs[lFound];
 		
 		if ((!isMarked) ||
 			(p_victim->fullyLinked && p_victim->topLevel == lFound && !p_victim->marked)) 
 		{
-			ST_SPLIT(self);
 			if (!isMarked) {
-				ST_SPLIT(self);
 				topLevel = p_victim->topLevel;
 				sl_node_lock(self, p_victim);
 				if (p_victim->marked) {
-					ST_SPLIT(self);
 					sl_node_unlock(self, p_victim);
 					ret = 0;
 					break;
@@ -981,31 +1425,31 @@ int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int ke
 
 			for (level = 0; valid && (level <= topLevel); level++)
 			{
-				ST_SPLIT(self);
 				p_pred = p_preds[level];
 				if (level == 0 || p_preds[level] != p_preds[level - 1]) { // don't do twice
-					ST_SPLIT(self);
 					sl_node_lock(self, p_pred);
 				}
 				highestLocked = level;
 				valid = !p_pred->marked && p_pred->p_next[level] == p_victim;
 				if (!valid) {
-					SL_TRACE_IN_HTM("[%d] skiplist_remove_stacktrack: not valid [p_pred->marked = %d]\n", (int)self->uniq_id, p_pred->marked);
+					SL_TRACE_IN_HTM("[%d] skiplist_remove_ibr: not valid [p_pred->marked = %d]\n", (int)self->uniq_id, p_pred->marked);
 				}
 			}
 			
+			
+			
 			if (valid) {
-				ST_SPLIT(self);
 				for (level = topLevel; level >= 0; level--) {
-					ST_SPLIT(self);
 					p_preds[level]->p_next[level] = p_victim->p_next[level];
 					p_victim->p_next[level] = NULL;
 				}
 				sl_node_unlock(self, p_victim);
 				ret = 1;
+				if (p_value != NULL) {
+					*p_value = p_victim->value;
+				}
 				
 			} else {
-				ST_SPLIT(self);
 				p_victim->marked = 0;
 				isMarked = 0;
 				sl_node_unlock(self, p_victim);
@@ -1014,33 +1458,25 @@ int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int ke
 			
 			// unlock mutexes
 			for (i = 0; i <= highestLocked; i++) {
-				ST_SPLIT(self);
 				if (i == 0 || p_preds[i] != p_preds[i - 1]) {
-					ST_SPLIT(self);
 					sl_node_unlock(self, p_preds[i]);
 				}
 			}
 			
 			if (valid) {
-				ST_SPLIT(self);
 				break;
 			}
 		}
 
 	}
 
-	ST_split_finish(self);
-	
-	ST_stack_del(self);
-	
-	ST_finish(self);
+	ST_IBR_finish(self);
 	
 	if (ret == 1) {
-		SL_TRACE("[%d] skiplist_remove_stacktrack: ST_FREE p_victim = %p\n", (int)self->uniq_id, p_victim);
-		ST_free(self, (int64_t *)p_victim);
+		ST_IBR_retire(self, (int64_t *)p_victim, p_victim->birth_era);
 	}
 
-	SL_TRACE("[%d] skiplist_remove_stacktrack: finish\n", (int)self->uniq_id);
+	SL_TRACE("[%d] skiplist_remove_ibr: finish\n", (int)self->uniq_id);
 	return ret;
 }
 
@@ -1060,15 +1496,32 @@ int skiplist_size(skiplist_t *p_skiplist) {
 	return n_nodes;
 }
 
+long skiplist_node_bytes(skiplist_t *p_skiplist) {
+	long n_bytes;
+	volatile sl_node_t *p_node;
+	
+	n_bytes = 0;
+	p_node = p_skiplist->p_head->p_next[0];
+	
+	while (p_node->p_next[0] != NULL) {
+		n_bytes += SL_NODE_SIZE(p_node->topLevel);
+		p_node = p_node->p_next[0];
+	}
+
+	return n_bytes;
+}
+
 void skiplist_print_stats(skiplist_t *p_skiplist) {
 	int level;
 	int n_nodes;
+	long n_bytes;
 	volatile sl_node_t *p_node;
 	
 	printf("-------------------------------------------------\n");
 	printf("  Skip-List status:\n");
+	printf("    max_level = %d\n", p_skiplist->max_level);
 
-	for (level = SKIPLIST_MAX_LEVEL-1; level >= 0; level--)
+	for (level = p_skiplist->max_level-1; level >= 0; level--)
 	{
 		n_nodes = 0;
 		p_node = p_skiplist->p_head;
@@ -1083,6 +1536,11 @@ void skiplist_print_stats(skiplist_t *p_skiplist) {
 		
 	}
 	
+	n_nodes = skiplist_size(p_skiplist);
+	n_bytes = skiplist_node_bytes(p_skiplist);
+	printf("    node bytes = %ld (%.1f per node, %d with a full tower)\n", n_bytes, 
+		n_nodes ? (double)n_bytes / (double)n_nodes : 0.0, (int)SL_NODE_SIZE(p_skiplist->max_level-1));
+	
 	printf("-------------------------------------------------\n");
 	
 	HTM_print_stats();
@@ -5,53 +5,80 @@
 ///////////////////////////////////////////////////////////////////////////////
 // INCLUDES
 ///////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
 #include "stack-track.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // DEFINES
 ///////////////////////////////////////////////////////////////////////////////
-#define SKIPLIST_MAX_LEVEL (10)
+// The number of levels is chosen at init from the expected set size
+#define SKIPLIST_MIN_LEVEL (10)
+#define SKIPLIST_MAX_LEVEL (32)
+
+// The sentinels hold the extreme keys. A traversal never compares the head,
+// and stops at the tail by identity, so every 64-bit value is a user key.
+#define MIN_KEY ((sl_key_t)0)
+#define MAX_KEY (~(sl_key_t)0)
 
-#define MIN_KEY (0)
-#define MAX_KEY (1 << 28)
+#define SL_NODE_SIZE(topLevel) (sizeof(sl_node_t) + (((topLevel) + 1) * sizeof(sl_node_t *)))
 
 ///////////////////////////////////////////////////////////////////////////////
 // TYPES
 ///////////////////////////////////////////////////////////////////////////////
+typedef uint64_t sl_key_t;
+typedef uintptr_t sl_value_t;
+
 typedef struct _sl_node_t {
 	volatile long lock;
-	volatile int key;
+	volatile sl_key_t key;
+	volatile sl_value_t value;
 	volatile int topLevel;
 	volatile int marked;
 	volatile int fullyLinked;
-	volatile struct _sl_node_t *p_next[SKIPLIST_MAX_LEVEL];
+	// the era of the allocation (interval-based reclamation)
+	int64_t birth_era;
+	// the tower has topLevel+1 entries
+	volatile struct _sl_node_t *p_next[];
 
 } sl_node_t;
 
 typedef struct _skiplist_t {
 	volatile sl_node_t *p_head;
 	volatile sl_node_t *p_tail;
+	int max_level;
 	
 } skiplist_t;
 
 ///////////////////////////////////////////////////////////////////////////////
 // EXTERNAL FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////
-skiplist_t *skiplist_init();
+skiplist_t *skiplist_init(long expected_size);
+// Frees the set and its nodes. No other thread may access the set.
+void skiplist_destroy(st_thread_t *self, skiplist_t *p_skiplist);
 
-int skiplist_contains_pure(st_thread_t *self, skiplist_t *p_skiplist, int key);
-int skiplist_contains_hp(st_thread_t *self, skiplist_t *p_skiplist, int key);
-int skiplist_contains_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key);
+int skiplist_get_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_get_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_get_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_get_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_get_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
 
-volatile sl_node_t *skiplist_insert_pure(st_thread_t *self, skiplist_t *p_skiplist, int key);
-volatile sl_node_t *skiplist_insert_hp(st_thread_t *self, skiplist_t *p_skiplist, int key);
-volatile sl_node_t *skiplist_insert_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key);
+// Returns 1 if the key was inserted, and 0 if the value of an existing key
+// was replaced (the old value is returned in p_old_value)
+int skiplist_put_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
+int skiplist_put_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
+int skiplist_put_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
+int skiplist_put_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
+int skiplist_put_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
 
-int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, int key);
-int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, int key);
-int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, int key);
+int skiplist_remove_pure(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_remove_hp(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_remove_stacktrack(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_remove_ebr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+int skiplist_remove_ibr(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
 
 int skiplist_size(skiplist_t *p_skiplist);
+long skiplist_node_bytes(skiplist_t *p_skiplist);
 void skiplist_print_stats(skiplist_t *p_skiplist);
 
 #endif // SKIPLIST_H
\ No newline at end of file
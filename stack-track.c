@@ -8,6 +8,10 @@
 #include <malloc.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <x86intrin.h>
 
 #include "common.h"
 #include "atomics.h"
@@ -20,296 +24,2559 @@
   
 #define ST_TRACE(format, ...) //printf(format, __VA_ARGS__)
 
+// The scan kernels read the published stacks of running threads, including
+// frames that were already popped, which address sanitizer builds reject
+#define ST_NO_SANITIZE __attribute__((no_sanitize_address))
+
 ///////////////////////////////////////////////////////////////////////////////
 // TYPES
 ///////////////////////////////////////////////////////////////////////////////
-typedef struct _st_stats_t {
-	long n_ops;
-	long n_splits;
-	long n_split_length;
-	long n_stack_scans;
-	long n_slow_path_segments;
+
+// A thread slot. Scanners hold a slot reference while they read the 
+// registered thread, and a deregistering thread waits for the references 
+// to drain before its st_thread_t may be reused.
+typedef struct _st_slot_t {
+	volatile st_thread_t *p_thread;
+	volatile int64_t n_refs;
+	volatile long gen;
+	char padding[40];
+	
+} st_slot_t;
+
+// A background reclaimer: a registered thread that never runs operations,
+// and drains the retire queues of the workers assigned to it
+typedef struct _st_reclaimer_t {
+	int id;
+	pthread_t thread;
+	st_thread_t *p_st;
+	int seed;
+	st_retire_batch_t *p_pending;
+	long n_busy_nsec;
+	long n_rounds;
 	
-} st_stats_t;
+} st_reclaimer_t;
 
 ///////////////////////////////////////////////////////////////////////////////
 // GLOBALS
 ///////////////////////////////////////////////////////////////////////////////
-static volatile long g_uniq_id = 0;
 static volatile long g_n_threads = 0;
-static volatile st_thread_t *g_st_threads[ST_MAX_THREADS];
+static st_slot_t g_st_slots[ST_MAX_THREADS];
+static volatile int64_t g_st_live_mask[ST_LIVE_MASK_WORDS];
+
+static st_retire_batch_t * volatile g_st_orphans = NULL;
+static volatile long g_n_orphans_pending = 0;
+
+static volatile int g_st_n_reclaimers = 0;
+static volatile int g_st_reclaimers_stop = 0;
+static st_reclaimer_t *g_st_reclaimers = NULL;
+static volatile long g_st_reclaimers_busy_nsec = 0;
+static volatile long g_st_reclaimers_rounds = 0;
+static int g_st_reclaimer_scan_mode = ST_SCAN_MODE_BATCH;
+static int g_st_n_reclaimers_started = 0;
 
 static volatile st_stats_t g_st_stats;
 
+static volatile int64_t g_st_n_unreclaimed = 0;
+
+// The epoch of epoch-based reclamation, read at every operation
+static volatile int64_t g_st_epoch __attribute__((aligned(64))) = 0;
+
+// The era of interval-based reclamation, read inline by ST_IBR_READ
+volatile int64_t g_st_era __attribute__((aligned(64))) = 0;
+
+static int g_st_alloc_type = ST_ALLOC_MALLOC;
+static int g_st_prealloc = 1;
+
+static st_split_params_t g_st_split_params = {
+	ST_SEGMENT_MAX_HTM_ABORTS,
+	ST_SEGMENT_MIN_LENGTH,
+	ST_SEGMENT_LEN_DELTA,
+	ST_SEGMENT_MIN_SUCCESS_FOR_INC
+};
+static int g_st_split_policies[ST_MAX_THREADS] = {ST_SPLIT_POLICY_ADDITIVE};
+static int g_st_n_split_policies = 1;
+
+// The telemetry of the finished threads, merged under the lock
+static int g_st_telemetry = 0;
+static pthread_mutex_t g_st_telemetry_lock = PTHREAD_MUTEX_INITIALIZER;
+static st_segment_table_t g_st_telemetry_tables[ST_MAX_OPS];
+
+// The shared segment model: 0 marks a limit that nobody published yet
+static int g_st_model_enabled = 1;
+static volatile int g_st_model_limits[ST_MAX_OPS][ST_MODEL_MAX_SEGMENTS];
+
+void ST_scan_and_free(st_thread_t *self);
+int ST_inc_scan_step(st_thread_t *self);
+static void ST_EBR_thread_finish(st_thread_t *self);
+static void ST_IBR_thread_finish(st_thread_t *self);
+
 ///////////////////////////////////////////////////////////////////////////////
-// Stack Track - Thread Management
+// Stack Track - Node Allocation
+//
+// Nodes come either from malloc or from the thread's pool. The reclaimer
+// returns them the same way, so a pool node freed by another thread goes 
+// back to its owner in batches.
+///////////////////////////////////////////////////////////////////////////////
+void ST_allocator_init(int alloc_type) {
+	g_st_alloc_type = alloc_type;
+}
+
+const char *ST_allocator_name(int alloc_type) {
+	switch (alloc_type) {
+		case ST_ALLOC_MALLOC: return "malloc";
+		case ST_ALLOC_POOL: return "pool";
+		default: return "unknown";
+	}
+}
+
+void *ST_alloc(st_thread_t *self, size_t size) {
+	void *ptr;
+	unsigned long long start_cycles;
+	
+	start_cycles = __rdtsc();
+	
+	if (g_st_alloc_type == ST_ALLOC_POOL) {
+		ptr = POOL_alloc(self->p_pool, size);
+	} else {
+		ptr = malloc(size);
+	}
+	
+	self->stats.n_alloc_cycles += __rdtsc() - start_cycles;
+	self->stats.n_allocs++;
+	if (self->is_htm_active) {
+		self->stats.n_allocs_in_htm++;
+	}
+	
+	return ptr;
+}
+
+void ST_dealloc(st_thread_t *self, void *ptr) {
+	unsigned long long start_cycles;
+	
+	start_cycles = __rdtsc();
+	
+	if (g_st_alloc_type == ST_ALLOC_POOL) {
+		POOL_free(self->p_pool, ptr);
+	} else {
+		free(ptr);
+	}
+	
+	self->stats.n_free_cycles += __rdtsc() - start_cycles;
+	self->stats.n_frees++;
+}
+
+// Allocator calls inside a hardware transaction grow its write set, and a 
+// system call aborts it. An operation that may need a node reserves it 
+// before its first segment, and takes it once the node gets linked. A 
+// reservation the operation did not use is kept for the next one.
+void ST_prealloc_init(int is_enabled) {
+	g_st_prealloc = is_enabled;
+}
+
+void *ST_prealloc_reserve(st_thread_t *self, size_t size) {
+	if (!g_st_prealloc) {
+		return NULL;
+	}
+	
+	if (self->p_prealloc != NULL) {
+		if (self->prealloc_size >= size) {
+			self->stats.n_prealloc_recycled++;
+			return self->p_prealloc;
+		}
+		
+		ST_dealloc(self, self->p_prealloc);
+	}
+	
+	self->p_prealloc = ST_alloc(self, size);
+	self->prealloc_size = size;
+	self->stats.n_prealloc_reserved++;
+	
+	return self->p_prealloc;
+}
+
+// May run inside HTM: an abort also rolls back the take
+void ST_prealloc_take(st_thread_t *self) {
+	self->p_prealloc = NULL;
+	self->prealloc_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Unreclaimed Nodes
+//
+// Every thread counts the nodes it retired and the retired nodes it freed.
+// The difference goes to a global count in batches, and the global peak is
+// kept at every batch.
+///////////////////////////////////////////////////////////////////////////////
+static void ST_unreclaimed_flush(st_thread_t *self) {
+	int64_t n_unreclaimed;
+	int64_t n_peak;
+	
+	if (self->unreclaimed_delta == 0) {
+		return;
+	}
+	
+	n_unreclaimed = atomic_add(&g_st_n_unreclaimed, self->unreclaimed_delta) + self->unreclaimed_delta;
+	self->unreclaimed_delta = 0;
+	
+	do {
+		n_peak = g_st_stats.n_unreclaimed_peak;
+	} while ((n_unreclaimed > n_peak) && 
+	         (CAS((volatile int64_t *)&(g_st_stats.n_unreclaimed_peak), n_peak, n_unreclaimed) != n_peak));
+}
+
+static inline void ST_unreclaimed_add(st_thread_t *self, long n_retired, long n_reclaimed) {
+	long n_unreclaimed;
+	
+	self->stats.n_retired += n_retired;
+	self->stats.n_reclaimed += n_reclaimed;
+	
+	n_unreclaimed = self->stats.n_retired - self->stats.n_reclaimed;
+	if (n_unreclaimed > self->stats.n_unreclaimed_peak) {
+		self->stats.n_unreclaimed_peak = n_unreclaimed;
+	}
+	
+	self->unreclaimed_delta += n_retired - n_reclaimed;
+	if ((self->unreclaimed_delta >= ST_UNRECLAIMED_FLUSH) || (self->unreclaimed_delta <= -ST_UNRECLAIMED_FLUSH)) {
+		ST_unreclaimed_flush(self);
+	}
+}
+
+void ST_leak(st_thread_t *self) {
+	ST_unreclaimed_add(self, 1, 0);
+}
+
+long ST_thread_unreclaimed(st_thread_t *self) {
+	return self->stats.n_retired - self->stats.n_reclaimed;
+}
+
+long ST_unreclaimed() {
+	return g_st_n_unreclaimed;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
-void ST_thread_init(st_thread_t *self, int *p_seed, int max_segment_len, int free_list_max_size) {
+// Stack Track - Thread Slots
+///////////////////////////////////////////////////////////////////////////////
+static void ST_live_mask_update(int slot_id, int is_live) {
+	volatile int64_t *p_word = &(g_st_live_mask[slot_id / 64]);
+	int64_t bit = ((int64_t)1) << (slot_id % 64);
+	int64_t old_word;
+	int64_t new_word;
+	
+	do {
+		old_word = *p_word;
+		new_word = is_live ? (old_word | bit) : (old_word & ~bit);
+	} while (CAS(p_word, old_word, new_word) != old_word);
+	
+}
+
+static int ST_live_mask_is_empty() {
 	int i;
-	int j;
 	
-	memset(self, 0, sizeof(st_thread_t));
+	for (i = 0; i < ST_LIVE_MASK_WORDS; i++) {
+		if (g_st_live_mask[i] != 0) {
+			return 0;
+		}
+	}
+	
+	return 1;
+}
 
-	self->uniq_id = atomic_add(&g_uniq_id, 1);
+static int ST_slot_alloc(st_thread_t *self) {
+	int slot_id;
 	
-	self->p_seed = p_seed;
+	for (slot_id = 0; slot_id < ST_MAX_THREADS; slot_id++) {
+		if ((g_st_slots[slot_id].p_thread == NULL) &&
+			(g_st_slots[slot_id].n_refs == 0) &&
+			(CAS((volatile int64_t *)&(g_st_slots[slot_id].p_thread), 0, (int64_t)self) == 0)) {
+			g_st_slots[slot_id].gen++;
+			ST_live_mask_update(slot_id, 1);
+			return slot_id;
+		}
+	}
+	
+	printf("ERROR: too many live threads (max = %d)\n", ST_MAX_THREADS);
+	abort();
+}
+
+static void ST_slot_free(st_thread_t *self) {
+	st_slot_t *p_slot = &(g_st_slots[self->uniq_id]);
+	
+	ST_live_mask_update(self->uniq_id, 0);
+	
+	p_slot->p_thread = NULL;
+	MEMBARSTLD();
+	
+	// wait for the scanners that still read this thread
+	while (p_slot->n_refs != 0) {
+		CPU_RELAX;
+	}
+	
+}
+
+// Takes a reference on every live thread that is inside an operation and 
+// snapshots its stack counter. Returns the number of acquired threads.
+//
+// The stack counter is odd while a thread is inside an operation. A thread 
+// that is idle now may only start an operation after the free list was 
+// unlinked, so it cannot reference it and is skipped.
+static int ST_threads_acquire(st_thread_t *self, st_thread_t **p_threads, long *p_stack_counters) {
+	int i;
+	int slot_id;
+	int n_threads;
+	int64_t mask;
+	long stack_counter;
+	st_slot_t *p_slot;
+	st_thread_t *p_th;
+	
+	n_threads = 0;
+	
+	for (i = 0; i < ST_LIVE_MASK_WORDS; i++) {
+		mask = g_st_live_mask[i];
 		
-	self->max_segment_len = max_segment_len;	
-	self->free_list_max_size = free_list_max_size;
-	 
-	self->segments[ST_MAX_OPS][ST_MAX_SEGMENTS];
+		while (mask != 0) {
+			slot_id = (i * 64) + __builtin_ctzll(mask);
+			mask &= mask - 1;
+			
+			p_slot = &(g_st_slots[slot_id]);
+			atomic_add(&(p_slot->n_refs), 1);
+			
+			p_th = (st_thread_t *)p_slot->p_thread;
+			if (p_th == NULL) {
+				atomic_add(&(p_slot->n_refs), -1);
+				continue;
+			}
+			
+			stack_counter = p_th->stack_counter;
+			if (!ST_IS_IN_OP(stack_counter)) {
+				atomic_add(&(p_slot->n_refs), -1);
+				self->stats.n_scan_threads_skipped++;
+				continue;
+			}
+			
+			p_threads[n_threads] = p_th;
+			p_stack_counters[n_threads] = stack_counter;
+			n_threads++;
+		}
+	}
 	
-	for (i = 0; i < ST_MAX_OPS; i++) {
-		for (j = 0; j < ST_MAX_SEGMENTS; j++) {
-			self->segments[i][j].n_limit = max_segment_len;
+	self->stats.n_scan_threads_scanned += n_threads;
+	
+	return n_threads;
+}
+
+static void ST_threads_release(st_thread_t **p_threads, int n_threads) {
+	int i;
+	
+	for (i = 0; i < n_threads; i++) {
+		atomic_add(&(g_st_slots[p_threads[i]->uniq_id].n_refs), -1);
+	}
+	
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Retire Batches
+//
+// Batches of retired pointers are passed between threads on lock-free 
+// stacks. Consumers always detach the whole stack, so the pops are ABA-free.
+///////////////////////////////////////////////////////////////////////////////
+static st_retire_batch_t *ST_batch_alloc(int max_ptrs) {
+	st_retire_batch_t *p_batch;
+	
+	p_batch = (st_retire_batch_t *)malloc(sizeof(st_retire_batch_t) + (max_ptrs * sizeof(int64_t *)));
+	if (p_batch == NULL) {
+		abort();
+	}
+	
+	p_batch->p_next = NULL;
+	p_batch->epoch = 0;
+	p_batch->n_ptrs = 0;
+	p_batch->max_ptrs = max_ptrs;
+	
+	return p_batch;
+}
+
+static void ST_batch_push(st_retire_batch_t * volatile *p_stack, st_retire_batch_t *p_batch) {
+	st_retire_batch_t *p_head;
+	
+	do {
+		p_head = *p_stack;
+		p_batch->p_next = p_head;
+	} while (CAS((volatile int64_t *)p_stack, (int64_t)p_head, (int64_t)p_batch) != (int64_t)p_head);
+	
+}
+
+static st_retire_batch_t *ST_batch_pop_all(st_retire_batch_t * volatile *p_stack) {
+	st_retire_batch_t *p_head;
+	
+	do {
+		p_head = *p_stack;
+		if (p_head == NULL) {
+			return NULL;
 		}
+	} while (CAS((volatile int64_t *)p_stack, (int64_t)p_head, 0) != (int64_t)p_head);
+	
+	return p_head;
+}
+
+// Moves pointers from the batch into the free list of self, until the
+// free list reaches max_free_list_size. Returns the number of moved pointers.
+static int ST_batch_take(st_thread_t *self, st_retire_batch_t *p_batch, int max_free_list_size) {
+	int n_taken;
+	
+	n_taken = 0;
+	
+	while ((p_batch->n_ptrs > 0) && (self->free_list_size < max_free_list_size)) {
+		p_batch->n_ptrs--;
+		self->free_list[self->free_list_size].ptr_to_free = p_batch->ptrs[p_batch->n_ptrs];
+		self->free_list_size++;
+		n_taken++;
 	}
 	
-	self->p_htm_data = &(self->htm_data);
-	HTM_thread_init(self->p_htm_data);
+	return n_taken;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Orphaned Free Lists
+///////////////////////////////////////////////////////////////////////////////
+static void ST_orphans_give(st_thread_t *self) {
+	int i;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	// retired pointers that no reclaimer has collected yet
+	if (self->p_retire_cur != NULL) {
+		ST_batch_push(&(self->p_retired), self->p_retire_cur);
+		self->p_retire_cur = NULL;
+	}
+	
+	p_batch = ST_batch_pop_all(&(self->p_retired));
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
 		
-	g_st_threads[self->uniq_id] = self;
-	atomic_add(&g_n_threads, 1);
+		atomic_add(&g_n_orphans_pending, p_batch->n_ptrs);
+		self->stats.n_orphaned += p_batch->n_ptrs;
+		ST_batch_push(&g_st_orphans, p_batch);
+		
+		p_batch = p_next;
+	}
+	
+	if (self->free_list_size == 0) {
+		return;
+	}
+	
+	p_batch = ST_batch_alloc(self->free_list_size);
+	
+	for (i = 0; i < self->free_list_size; i++) {
+		p_batch->ptrs[i] = self->free_list[i].ptr_to_free;
+	}
+	p_batch->n_ptrs = self->free_list_size;
+	
+	atomic_add(&g_n_orphans_pending, self->free_list_size);
+	self->stats.n_orphaned += self->free_list_size;
+	self->free_list_size = 0;
 	
+	ST_batch_push(&g_st_orphans, p_batch);
 }
 
-void ST_thread_finish(st_thread_t *self) {
-	HTM_thread_finish(self->p_htm_data);
+// Moves orphaned pointers into the free list of self, as long as they 
+// fit below the free list threshold. The rest are pushed back.
+void ST_orphans_adopt(st_thread_t *self) {
+	int n_taken;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	if (likely(g_st_orphans == NULL)) {
+		return;
+	}
+	
+	p_batch = ST_batch_pop_all(&g_st_orphans);
+	
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
+		
+		n_taken = ST_batch_take(self, p_batch, self->free_list_max_size - 1);
+		self->stats.n_adopted += n_taken;
+		atomic_add(&g_n_orphans_pending, -n_taken);
+		
+		if (p_batch->n_ptrs == 0) {
+			free(p_batch);
+		} else {
+			ST_batch_push(&g_st_orphans, p_batch);
+		}
+		
+		p_batch = p_next;
+	}
+	
+}
+
+// Without live threads nobody can reference a retired node
+static void ST_orphans_free_all(st_thread_t *self) {
+	int i;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	p_batch = ST_batch_pop_all(&g_st_orphans);
+	
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
+		
+		for (i = 0; i < p_batch->n_ptrs; i++) {
+			ST_dealloc(self, p_batch->ptrs[i]);
+		}
+		atomic_add(&g_n_orphans_pending, -p_batch->n_ptrs);
+		ST_unreclaimed_add(self, 0, p_batch->n_ptrs);
+		
+		free(p_batch);
+		p_batch = p_next;
+	}
 	
-	atomic_add(&(g_st_stats.n_ops), self->stats.n_ops);
-	atomic_add(&(g_st_stats.n_splits), self->stats.n_splits);
-	atomic_add(&(g_st_stats.n_split_length), self->stats.n_split_length);
-	atomic_add(&(g_st_stats.n_stack_scans), self->stats.n_stack_scans);
-	atomic_add(&(g_st_stats.n_slow_path_segments), self->stats.n_slow_path_segments);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Stack Track - Operation Management
+// Stack Track - Split Policies
+//
+// additive: the original policy. A capacity abort shortens the segment by
+// len_delta, and min_success_for_inc commits in a row lengthen it by 
+// len_delta.
+// multiplicative: a capacity abort halves the segment, and it grows back 
+// additively (AIMD). It converges faster on operations with long 
+// conflict-free stretches and one expensive part.
+// fixed: every segment is max_segment_len long. A segment that does not 
+// fit in HTM ends on the slow path.
 ///////////////////////////////////////////////////////////////////////////////
-void ST_init(st_thread_t *self) {
-	self->is_slow_path = 1;
-	self->n_next_stack = 0;
-	self->n_stacks = 0;
-	ST_HP_reset(self);
-	MEMBARSTLD();
+static int ST_split_additive_increase(st_segment_t *p_seg, UNUSED int max_segment_len, const st_split_params_t *p_params) {
+	if (p_seg->n_htm_success - p_seg->saved_n_htm_success > p_params->min_success_for_inc) {
+		return p_seg->n_limit + p_params->len_delta;
+	}
+	
+	return p_seg->n_limit;
 }
 
-void ST_finish(st_thread_t *self) {
-	self->n_stacks = 0;
-	self->n_next_stack = 0;
-	self->n_hp_records = 0;	
+static int ST_split_additive_decrease(st_segment_t *p_seg, UNUSED int max_segment_len, const st_split_params_t *p_params) {
+	return p_seg->n_limit - p_params->len_delta;
+}
+
+static int ST_split_multiplicative_decrease(st_segment_t *p_seg, UNUSED int max_segment_len, UNUSED const st_split_params_t *p_params) {
+	return p_seg->n_limit / 2;
+}
+
+static int ST_split_fixed(UNUSED st_segment_t *p_seg, int max_segment_len, UNUSED const st_split_params_t *p_params) {
+	return max_segment_len;
+}
+
+static const st_split_policy_t g_st_split_policy_table[ST_SPLIT_N_POLICIES] = {
+	{"additive", 1, ST_split_additive_decrease, ST_split_additive_increase},
+	{"multiplicative", 1, ST_split_multiplicative_decrease, ST_split_additive_increase},
+	{"fixed", 0, ST_split_fixed, ST_split_fixed},
+};
+
+void ST_split_policy_init(const int *policies, int n_policies, const st_split_params_t *p_params) {
+	int i;
 	
-	self->stack_counter++;
+	if ((n_policies < 1) || (n_policies > ST_MAX_THREADS)) {
+		printf("ERROR: invalid number of split policies [%d]\n", n_policies);
+		abort();
+	}
 	
-	if (self->is_slow_path) {
-		self->is_slow_path = 0;
+	for (i = 0; i < n_policies; i++) {
+		if ((policies[i] < 0) || (policies[i] >= ST_SPLIT_N_POLICIES)) {
+			printf("ERROR: unknown split policy [%d]\n", policies[i]);
+			abort();
+		}
+		g_st_split_policies[i] = policies[i];
 	}
+	g_st_n_split_policies = n_policies;
 	
-	MEMBARSTLD();
+	if (p_params != NULL) {
+		g_st_split_params = *p_params;
+	}
+}
+
+const char *ST_split_policy_name(int split_policy) {
+	if ((split_policy < 0) || (split_policy >= ST_SPLIT_N_POLICIES)) {
+		return "unknown";
+	}
+	
+	return g_st_split_policy_table[split_policy].name;
+}
+
+static inline int ST_split_limit_clamp(st_thread_t *self, int limit) {
+	if (limit > self->max_segment_len) {
+		limit = self->max_segment_len;
+	}
+	if (limit < g_st_split_params.min_length) {
+		limit = g_st_split_params.min_length;
+	}
 	
+	return limit;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Stack Track - Stack Management
+// Stack Track - Segment Model
+//
+// A shared model of the segment limits that the threads learned. A new 
+// segment table entry starts from the model instead of max_segment_len, so
+// a new thread skips most of the capacity aborts of learning. Publishing 
+// runs once every ST_MODEL_PUBLISH_OPS operations, outside of HTM, and 
+// races between publishers only lose one of two valid merges.
 ///////////////////////////////////////////////////////////////////////////////
-void ST_stack_init(st_thread_t *self) {
-	self->stacks[self->n_next_stack].p_start = (int64_t *)0x0800000000000000;
-	self->stacks[self->n_next_stack].p_end = NULL;
+// Also forgets the published limits, so every run learns from scratch
+void ST_model_init(int is_enabled) {
+	g_st_model_enabled = is_enabled;
+	memset((void *)g_st_model_limits, 0, sizeof(g_st_model_limits));
+}
+
+static int ST_model_limit(st_thread_t *self, int op_index, int split_index) {
+	int limit;
+	
+	if ((!g_st_model_enabled) || (!self->p_split_policy->uses_model) || (split_index >= ST_MODEL_MAX_SEGMENTS)) {
+		return self->max_segment_len;
+	}
+	
+	limit = g_st_model_limits[op_index][split_index];
+	if ((limit <= 0) || (limit > self->max_segment_len)) {
+		return self->max_segment_len;
+	}
 	
+	return limit;
 }
 
-void ST_stack_add_range(st_thread_t *self, char *p_stack, int n_bytes) {
-	char *p_start = (char *)self->stacks[self->n_next_stack].p_start;
-	char *p_end = (char *)self->stacks[self->n_next_stack].p_end;
+static void ST_model_publish(st_thread_t *self) {
+	int i;
+	int op_index;
+	int n_segments;
+	int old_limit;
+	int new_limit;
+	st_segment_table_t *p_table;
 	
-	//printf("ST_stack_add_range: [%ld] add [%p] [%d]\n", self->uniq_id, p_stack, n_bytes);
-	//printf("ST_stack_add_range: [%ld] cur [%p] [%p]\n", self->uniq_id, p_start, p_end);
-	if (p_stack < p_start) {
-		self->stacks[self->n_next_stack].p_start = (int64_t *)p_stack;
+	if ((!g_st_model_enabled) || (!self->p_split_policy->uses_model)) {
+		return;
+	}
+	
+	for (op_index = 0; op_index < ST_MAX_OPS; op_index++) {
+		p_table = &(self->segment_tables[op_index]);
+		
+		n_segments = p_table->n_segments;
+		if (n_segments > ST_MODEL_MAX_SEGMENTS) {
+			n_segments = ST_MODEL_MAX_SEGMENTS;
+		}
+		
+		for (i = 0; i < n_segments; i++) {
+			if (p_table->p_segments[i].n_htm_success == 0) {
+				// not learned yet
+				continue;
+			}
+			
+			old_limit = g_st_model_limits[op_index][i];
+			new_limit = p_table->p_segments[i].n_limit;
+			if (old_limit > 0) {
+				new_limit = (old_limit + new_limit) / 2;
+			}
+			
+			if (new_limit != old_limit) {
+				g_st_model_limits[op_index][i] = new_limit;
+			}
+		}
 	}
 	
-	if ((p_stack + n_bytes) > p_end) {
-		self->stacks[self->n_next_stack].p_end = (int64_t *)(p_stack + n_bytes);
+	self->stats.n_model_publishes++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Telemetry
+//
+// Counts the HTM attempts, aborts and commits of every segment, so split 
+// points can be placed from data. A thread counts into its segment tables
+// without synchronization, and merges them into the global tables when it
+// finishes. Disabled, it costs one predictable branch per segment.
+///////////////////////////////////////////////////////////////////////////////
+static const char *g_st_telemetry_causes[ST_TELEMETRY_N_CAUSES] = {
+	"explicit", "retry", "conflict", "capacity", "debug", "nested", "none"
+};
+
+static const unsigned int g_st_telemetry_cause_bits[ST_TELEMETRY_N_CAUSES - 1] = {
+	_XABORT_EXPLICIT, _XABORT_RETRY, _XABORT_CONFLICT, _XABORT_CAPACITY, _XABORT_DEBUG, _XABORT_NESTED
+};
+
+void ST_telemetry_init(int is_enabled) {
+	g_st_telemetry = is_enabled;
+}
+
+static void ST_telemetry_grow(st_segment_table_t *p_table, int n_segments) {
+	st_segment_telemetry_t *p_telemetry;
+	
+	p_telemetry = (st_segment_telemetry_t *)realloc(p_table->p_telemetry, n_segments * sizeof(st_segment_telemetry_t));
+	if (p_telemetry == NULL) {
+		abort();
+	}
+	
+	memset(&(p_telemetry[p_table->n_segments]), 0, (n_segments - p_table->n_segments) * sizeof(st_segment_telemetry_t));
+	
+	p_table->p_telemetry = p_telemetry;
+}
+
+static void ST_telemetry_add_code(st_segment_telemetry_t *p_telemetry, int code, long n_aborts) {
+	int i;
+	
+	for (i = 0; i < ST_TELEMETRY_MAX_CODES; i++) {
+		if ((p_telemetry->n_explicit_codes[i] == 0) || (p_telemetry->explicit_codes[i] == code)) {
+			p_telemetry->explicit_codes[i] = code;
+			p_telemetry->n_explicit_codes[i] += n_aborts;
+			return;
+		}
+	}
+	
+	p_telemetry->n_explicit_other += n_aborts;
+}
+
+static void ST_telemetry_abort(st_segment_telemetry_t *p_telemetry, unsigned int status) {
+	int i;
+	
+	if (status == 0) {
+		p_telemetry->n_aborts[ST_TELEMETRY_N_CAUSES - 1]++;
+		return;
+	}
+	
+	for (i = 0; i < ST_TELEMETRY_N_CAUSES - 1; i++) {
+		if (status & g_st_telemetry_cause_bits[i]) {
+			p_telemetry->n_aborts[i]++;
+		}
+	}
+	
+	if (status & _XABORT_EXPLICIT) {
+		ST_telemetry_add_code(p_telemetry, _XABORT_CODE(status), 1);
+	}
+}
+
+static inline void ST_telemetry_commit(st_segment_telemetry_t *p_telemetry, int segment_len) {
+	p_telemetry->n_commits++;
+	p_telemetry->n_commit_lengths[(segment_len < ST_TELEMETRY_MAX_LEN) ? segment_len : ST_TELEMETRY_MAX_LEN]++;
+}
+
+static void ST_telemetry_merge(st_thread_t *self) {
+	int i;
+	int op_index;
+	int split_index;
+	st_segment_table_t *p_table;
+	st_segment_table_t *p_global;
+	st_segment_telemetry_t *p_src;
+	st_segment_telemetry_t *p_dst;
+	
+	pthread_mutex_lock(&g_st_telemetry_lock);
+	
+	for (op_index = 0; op_index < ST_MAX_OPS; op_index++) {
+		p_table = &(self->segment_tables[op_index]);
+		p_global = &(g_st_telemetry_tables[op_index]);
+		
+		if (p_table->p_telemetry == NULL) {
+			continue;
+		}
+		
+		if (p_global->n_segments < p_table->n_segments) {
+			ST_telemetry_grow(p_global, p_table->n_segments);
+			p_global->n_segments = p_table->n_segments;
+		}
+		
+		for (split_index = 0; split_index < p_table->n_segments; split_index++) {
+			p_src = &(p_table->p_telemetry[split_index]);
+			p_dst = &(p_global->p_telemetry[split_index]);
+			
+			p_dst->n_attempts += p_src->n_attempts;
+			p_dst->n_commits += p_src->n_commits;
+			p_dst->n_slow_path += p_src->n_slow_path;
+			for (i = 0; i < ST_TELEMETRY_N_CAUSES; i++) {
+				p_dst->n_aborts[i] += p_src->n_aborts[i];
+			}
+			for (i = 0; i < ST_TELEMETRY_MAX_CODES; i++) {
+				if (p_src->n_explicit_codes[i] > 0) {
+					ST_telemetry_add_code(p_dst, p_src->explicit_codes[i], p_src->n_explicit_codes[i]);
+				}
+			}
+			p_dst->n_explicit_other += p_src->n_explicit_other;
+			for (i = 0; i <= ST_TELEMETRY_MAX_LEN; i++) {
+				p_dst->n_commit_lengths[i] += p_src->n_commit_lengths[i];
+			}
+		}
+	}
+	
+	pthread_mutex_unlock(&g_st_telemetry_lock);
+}
+
+// Writes the telemetry of the threads that finished since the last 
+// ST_reset_stats as JSON. Returns 0 on 
+// success, and -1 if the file cannot be written.
+int ST_telemetry_export(const char *path) {
+	int i;
+	int op_index;
+	int split_index;
+	int is_first;
+	int is_first_len;
+	FILE *p_file;
+	st_segment_telemetry_t *p_telemetry;
+	
+	p_file = fopen(path, "w");
+	if (p_file == NULL) {
+		perror("fopen");
+		return -1;
+	}
+	
+	pthread_mutex_lock(&g_st_telemetry_lock);
+	
+	fprintf(p_file, "{\n");
+	fprintf(p_file, "  \"max_length_bucket\": %d,\n", ST_TELEMETRY_MAX_LEN);
+	fprintf(p_file, "  \"segments\": [");
+	
+	is_first = 1;
+	for (op_index = 0; op_index < ST_MAX_OPS; op_index++) {
+		for (split_index = 0; split_index < g_st_telemetry_tables[op_index].n_segments; split_index++) {
+			p_telemetry = &(g_st_telemetry_tables[op_index].p_telemetry[split_index]);
+			if (p_telemetry->n_attempts == 0) {
+				continue;
+			}
+			
+			fprintf(p_file, "%s\n    {\"op_index\": %d, \"split_index\": %d, ", is_first ? "" : ",", op_index, split_index);
+			fprintf(p_file, "\"attempts\": %ld, \"commits\": %ld, \"slow_path\": %ld,\n", 
+				p_telemetry->n_attempts, p_telemetry->n_commits, p_telemetry->n_slow_path);
+			
+			fprintf(p_file, "     \"aborts\": {");
+			for (i = 0; i < ST_TELEMETRY_N_CAUSES; i++) {
+				fprintf(p_file, "%s\"%s\": %ld", (i > 0) ? ", " : "", g_st_telemetry_causes[i], p_telemetry->n_aborts[i]);
+			}
+			fprintf(p_file, "},\n");
+			
+			fprintf(p_file, "     \"explicit_codes\": {");
+			for (i = 0; (i < ST_TELEMETRY_MAX_CODES) && (p_telemetry->n_explicit_codes[i] > 0); i++) {
+				fprintf(p_file, "%s\"%d\": %ld", (i > 0) ? ", " : "", p_telemetry->explicit_codes[i], p_telemetry->n_explicit_codes[i]);
+			}
+			if (p_telemetry->n_explicit_other > 0) {
+				fprintf(p_file, "%s\"other\": %ld", (i > 0) ? ", " : "", p_telemetry->n_explicit_other);
+			}
+			fprintf(p_file, "},\n");
+			
+			// [length, commits] pairs of the non-empty buckets
+			fprintf(p_file, "     \"commit_lengths\": [");
+			is_first_len = 1;
+			for (i = 0; i <= ST_TELEMETRY_MAX_LEN; i++) {
+				if (p_telemetry->n_commit_lengths[i] > 0) {
+					fprintf(p_file, "%s[%d, %ld]", is_first_len ? "" : ", ", i, p_telemetry->n_commit_lengths[i]);
+					is_first_len = 0;
+				}
+			}
+			fprintf(p_file, "]}");
+			
+			is_first = 0;
+		}
+	}
+	
+	fprintf(p_file, "\n  ]\n}\n");
+	
+	pthread_mutex_unlock(&g_st_telemetry_lock);
+	
+	if (fclose(p_file) != 0) {
+		perror("fclose");
+		return -1;
+	}
+	
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Segment Tables
+//
+// The learned segment lengths of every (op_index, split_index) pair. A 
+// thread only materializes the pairs its operations reach.
+///////////////////////////////////////////////////////////////////////////////
+// Runs outside of HTM, so the table may grow here
+static void ST_segment_table_grow(st_thread_t *self, int op_index, st_segment_table_t *p_table, int split_index) {
+	int i;
+	int n_segments;
+	st_segment_t *p_segments;
+	
+	n_segments = (p_table->n_segments == 0) ? ST_SEGMENTS_INIT : p_table->n_segments;
+	while (n_segments <= split_index) {
+		n_segments *= 2;
+	}
+	
+	p_segments = (st_segment_t *)realloc(p_table->p_segments, n_segments * sizeof(st_segment_t));
+	if (p_segments == NULL) {
+		abort();
+	}
+	
+	for (i = p_table->n_segments; i < n_segments; i++) {
+		p_segments[i].n_limit = ST_model_limit(self, op_index, i);
+		p_segments[i].saved_n_htm_success = 0;
+		p_segments[i].n_htm_success = 0;
+	}
+	
+	p_table->p_segments = p_segments;
+	
+	if (g_st_telemetry) {
+		ST_telemetry_grow(p_table, n_segments);
+	}
+	
+	p_table->n_segments = n_segments;
+}
+
+static inline st_segment_t *ST_segment_get(st_thread_t *self, int op_index, int split_index) {
+	st_segment_table_t *p_table = &(self->segment_tables[op_index]);
+	
+	if (unlikely(split_index >= p_table->n_segments)) {
+		ST_segment_table_grow(self, op_index, p_table, split_index);
+	}
+	
+	return &(p_table->p_segments[split_index]);
+}
+
+static void ST_segment_tables_free(st_thread_t *self) {
+	int i;
+	
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		free(self->segment_tables[i].p_segments);
+		self->segment_tables[i].p_segments = NULL;
+		free(self->segment_tables[i].p_telemetry);
+		self->segment_tables[i].p_telemetry = NULL;
+		self->segment_tables[i].n_segments = 0;
+	}
+	
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Thread Management
+///////////////////////////////////////////////////////////////////////////////
+void ST_thread_init(st_thread_t *self, int *p_seed, int max_segment_len, int free_list_max_size, int scan_mode) {
+	
+	memset(self, 0, sizeof(st_thread_t));
+
+	self->p_seed = p_seed;
+		
+	self->max_segment_len = max_segment_len;	
+	self->free_list_max_size = free_list_max_size;
+	self->scan_mode = scan_mode;
+	
+	self->ibr_lower = ST_IBR_IDLE;
+	self->ibr_upper = ST_IBR_IDLE;
+	 
+	self->p_htm_data = &(self->htm_data);
+	HTM_thread_init(self->p_htm_data);
+	
+	if (g_st_alloc_type == ST_ALLOC_POOL) {
+		self->p_pool = POOL_acquire();
+	}
+	
+	self->uniq_id = ST_slot_alloc(self);
+	atomic_add(&g_n_threads, 1);
+	
+	self->split_policy = g_st_split_policies[self->uniq_id % g_st_n_split_policies];
+	self->p_split_policy = &(g_st_split_policy_table[self->split_policy]);
+	
+}
+
+void ST_thread_finish(st_thread_t *self) {
+	int i;
+	long n_htm_aborts;
+	volatile st_split_policy_stats_t *p_policy_stats;
+	
+	// free what is already unreferenced, and hand the rest to other threads
+	if (self->free_list_size > 0) {
+		ST_scan_and_free(self);
+		self->stats.n_stack_scans++;
+	}
+	ST_EBR_thread_finish(self);
+	ST_IBR_thread_finish(self);
+	ST_orphans_give(self);
+	
+	ST_slot_free(self);
+	atomic_add(&g_n_threads, -1);
+	
+	if (ST_live_mask_is_empty()) {
+		ST_orphans_free_all(self);
+	}
+	
+	if (self->p_prealloc != NULL) {
+		ST_dealloc(self, self->p_prealloc);
+		ST_prealloc_take(self);
+	}
+	
+	if (self->p_pool != NULL) {
+		POOL_release(self->p_pool);
+		self->p_pool = NULL;
+	}
+	
+	ST_unreclaimed_flush(self);
+	
+	if (self->stats.n_ops > 0) {
+		ST_model_publish(self);
+		
+		self->stats.n_early_ops = (self->stats.n_ops < ST_EARLY_OPS) ? self->stats.n_ops : ST_EARLY_OPS;
+		self->stats.n_converge_ops = self->last_limit_change_op;
+		atomic_add(&(g_st_stats.n_model_threads), 1);
+	}
+	if (g_st_telemetry) {
+		ST_telemetry_merge(self);
+	}
+	ST_segment_tables_free(self);
+	
+	HTM_thread_finish(self->p_htm_data);
+	
+	atomic_add(&(g_st_stats.n_ops), self->stats.n_ops);
+	atomic_add(&(g_st_stats.n_splits), self->stats.n_splits);
+	atomic_add(&(g_st_stats.n_split_length), self->stats.n_split_length);
+	atomic_add(&(g_st_stats.n_stack_scans), self->stats.n_stack_scans);
+	atomic_add(&(g_st_stats.n_slow_path_segments), self->stats.n_slow_path_segments);
+	atomic_add(&(g_st_stats.n_scan_bytes), self->stats.n_scan_bytes);
+	atomic_add(&(g_st_stats.n_scan_nsec), self->stats.n_scan_nsec);
+	atomic_add(&(g_st_stats.n_orphaned), self->stats.n_orphaned);
+	atomic_add(&(g_st_stats.n_adopted), self->stats.n_adopted);
+	atomic_add(&(g_st_stats.n_scan_threads_scanned), self->stats.n_scan_threads_scanned);
+	atomic_add(&(g_st_stats.n_scan_threads_skipped), self->stats.n_scan_threads_skipped);
+	atomic_add(&(g_st_stats.n_retire_batches), self->stats.n_retire_batches);
+	atomic_add(&(g_st_stats.n_scan_steps), self->stats.n_scan_steps);
+	atomic_add(&(g_st_stats.n_allocs), self->stats.n_allocs);
+	atomic_add(&(g_st_stats.n_alloc_cycles), self->stats.n_alloc_cycles);
+	atomic_add(&(g_st_stats.n_frees), self->stats.n_frees);
+	atomic_add(&(g_st_stats.n_free_cycles), self->stats.n_free_cycles);
+	atomic_add(&(g_st_stats.n_allocs_in_htm), self->stats.n_allocs_in_htm);
+	atomic_add(&(g_st_stats.n_prealloc_reserved), self->stats.n_prealloc_reserved);
+	atomic_add(&(g_st_stats.n_prealloc_recycled), self->stats.n_prealloc_recycled);
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		atomic_add(&(g_st_stats.n_op_htm_aborts[i]), self->stats.n_op_htm_aborts[i]);
+	}
+	atomic_add(&(g_st_stats.n_early_ops), self->stats.n_early_ops);
+	atomic_add(&(g_st_stats.n_early_htm_aborts), self->stats.n_early_htm_aborts);
+	atomic_add(&(g_st_stats.n_converge_ops), self->stats.n_converge_ops);
+	atomic_add(&(g_st_stats.n_model_publishes), self->stats.n_model_publishes);
+	atomic_add(&(g_st_stats.n_retry_conflict), self->stats.n_retry_conflict);
+	atomic_add(&(g_st_stats.n_retry_capacity), self->stats.n_retry_capacity);
+	atomic_add(&(g_st_stats.n_retry_locked), self->stats.n_retry_locked);
+	atomic_add(&(g_st_stats.n_retry_other), self->stats.n_retry_other);
+	atomic_add(&(g_st_stats.n_backoff_spins), self->stats.n_backoff_spins);
+	atomic_add(&(g_st_stats.n_lock_waits_cleared), self->stats.n_lock_waits_cleared);
+	atomic_add(&(g_st_stats.n_retired), self->stats.n_retired);
+	atomic_add(&(g_st_stats.n_reclaimed), self->stats.n_reclaimed);
+	atomic_add(&(g_st_stats.n_epoch_scans), self->stats.n_epoch_scans);
+	atomic_add(&(g_st_stats.n_epoch_advances), self->stats.n_epoch_advances);
+	atomic_add(&(g_st_stats.n_era_scans), self->stats.n_era_scans);
+	atomic_add(&(g_st_stats.n_era_advances), self->stats.n_era_advances);
+	atomic_add(&(g_st_stats.n_era_reservations), self->stats.n_era_reservations);
+	
+	if (self->stats.n_ops > 0) {
+		p_policy_stats = &(g_st_stats.split_policies[self->split_policy]);
+		
+		n_htm_aborts = 0;
+		for (i = 0; i < ST_MAX_OPS; i++) {
+			n_htm_aborts += self->stats.n_op_htm_aborts[i];
+		}
+		
+		atomic_add(&(p_policy_stats->n_threads), 1);
+		atomic_add(&(p_policy_stats->n_ops), self->stats.n_ops);
+		atomic_add(&(p_policy_stats->n_splits), self->stats.n_splits);
+		atomic_add(&(p_policy_stats->n_split_length), self->stats.n_split_length);
+		atomic_add(&(p_policy_stats->n_htm_aborts), n_htm_aborts);
+		atomic_add(&(p_policy_stats->n_slow_path_segments), self->stats.n_slow_path_segments);
+		atomic_add(&(p_policy_stats->n_limit_changes), self->stats.n_limit_changes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Operation Management
+///////////////////////////////////////////////////////////////////////////////
+void ST_init(st_thread_t *self) {
+	self->is_slow_path = 1;
+	self->n_next_stack = 0;
+	self->n_stacks = 0;
+	ST_HP_reset(self);
+	
+	self->stack_counter++; // odd: inside an operation
+	
+	MEMBARSTLD();
+}
+
+void ST_finish(st_thread_t *self) {
+	self->n_stacks = 0;
+	self->n_next_stack = 0;
+	self->n_hp_records = 0;	
+	
+	self->stack_counter++; // even: idle
+	
+	if (self->is_slow_path) {
+		self->is_slow_path = 0;
+	}
+	
+	MEMBARSTLD();
+	
+	if (unlikely(self->is_inc_active)) {
+		if (ST_inc_scan_step(self)) {
+			self->stats.n_stack_scans++;
+		}
+	}
+	
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Stack Management
+///////////////////////////////////////////////////////////////////////////////
+void ST_stack_init(st_thread_t *self) {
+	self->stacks[self->n_next_stack].p_start = (int64_t *)0x0800000000000000;
+	self->stacks[self->n_next_stack].p_end = NULL;
+	
+}
+
+void ST_stack_add_range(st_thread_t *self, char *p_stack, int n_bytes) {
+	char *p_start = (char *)self->stacks[self->n_next_stack].p_start;
+	char *p_end = (char *)self->stacks[self->n_next_stack].p_end;
+	
+	//printf("ST_stack_add_range: [%ld] add [%p] [%d]\n", self->uniq_id, p_stack, n_bytes);
+	//printf("ST_stack_add_range: [%ld] cur [%p] [%p]\n", self->uniq_id, p_start, p_end);
+	if (p_stack < p_start) {
+		self->stacks[self->n_next_stack].p_start = (int64_t *)p_stack;
+	}
+	
+	if ((p_stack + n_bytes) > p_end) {
+		self->stacks[self->n_next_stack].p_end = (int64_t *)(p_stack + n_bytes);
+	}
+	
+	//printf("ST_stack_add_range: [%ld] new [%p] [%p]\n", self->uniq_id, 
+	//													self->stacks[self->n_next_stack].p_start,
+	//													self->stacks[self->n_next_stack].p_end);
+	
+}
+
+void ST_stack_publish(st_thread_t *self) {
+	self->n_stacks++;
+	self->n_next_stack = self->n_stacks;
+	MEMBARSTLD();
+}
+
+void ST_stack_del(st_thread_t *self) {
+	self->n_stacks--;
+	self->n_next_stack = self->n_stacks;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stack Track - Split Management
+///////////////////////////////////////////////////////////////////////////////
+void ST_split_start(st_thread_t *self, int op_index) {
+	self->op_index = op_index;
+	self->split_index = 0;
+	
+	if (self->is_slow_path) {
+		self->is_slow_path = 0;
+	}
+	
+	ST_split_segment_start(self);
+}
+
+void ST_split_finish(st_thread_t *self) {
+	ST_split_segment_finish(self);
+	self->stats.n_ops++;
+	
+	if ((self->stats.n_ops % ST_MODEL_PUBLISH_OPS) == 0) {
+		ST_model_publish(self);
+	}
+}
+
+static void ST_backoff(st_thread_t *self, int n_conflicts) {
+	long max_spins;
+	long n_spins;
+	
+	max_spins = ST_BACKOFF_MIN_SPINS;
+	while ((n_conflicts > 1) && (max_spins < ST_BACKOFF_MAX_SPINS)) {
+		max_spins *= 2;
+		n_conflicts--;
+	}
+	
+	n_spins = ((unsigned int)MY_RAND(self->p_seed)) % max_spins;
+	self->stats.n_backoff_spins += n_spins;
+	
+	while (n_spins-- > 0) {
+		CPU_RELAX;
+	}
+}
+
+// Retries the segment according to the abort cause: a capacity abort 
+// shrinks the segment at once, a lock abort waits for that lock in the 
+// retry (ST_LOCK_WAIT), and a conflict backs off
+void ST_split_segment_start(st_thread_t *self) {
+	unsigned int status;
+	long n_htm_aborts;
+	int n_conflicts;
+	int new_limit;
+	st_segment_t *p_seg;
+		
+	p_seg = ST_segment_get(self, self->op_index, self->split_index);
+	self->p_cur_segment = p_seg;
+	if (unlikely(g_st_telemetry)) {
+		self->p_cur_telemetry = &(self->segment_tables[self->op_index].p_telemetry[self->split_index]);
+		self->p_cur_telemetry->n_attempts++;
+	}
+	
+	self->cur_segment_limit = p_seg->n_limit;
+	self->cur_segment_len = 0;
+	
+	n_htm_aborts = 0;
+	n_conflicts = 0;
+	
+	self->is_htm_active = 1;
+	while (0 == HTM_start(self->p_htm_data)) {
+		self->is_htm_active = 0;
+
+		n_htm_aborts++;
+		self->stats.n_op_htm_aborts[self->op_index]++;
+		if (self->stats.n_ops < ST_EARLY_OPS) {
+			self->stats.n_early_htm_aborts++;
+		}
+		
+		status = self->p_htm_data->last_htm_abort;
+		
+		if (unlikely(g_st_telemetry)) {
+			ST_telemetry_abort(self->p_cur_telemetry, status);
+		}
+		
+		if (status & _XABORT_CAPACITY) {
+			self->stats.n_retry_capacity++;
+			
+			p_seg->saved_n_htm_success = p_seg->n_htm_success;
+			new_limit = ST_split_limit_clamp(self, 
+				self->p_split_policy->on_capacity_abort(p_seg, self->max_segment_len, &g_st_split_params));
+			if (new_limit != p_seg->n_limit) {
+				p_seg->n_limit = new_limit;
+				self->last_limit_change_op = self->stats.n_ops;
+				self->stats.n_limit_changes++;
+			}
+			self->cur_segment_limit = p_seg->n_limit;
+			
+		} else if ((status & _XABORT_EXPLICIT) && (_XABORT_CODE(status) == HTM_ABORT_LOCKED)) {
+			self->stats.n_retry_locked++;
+			self->lock_wait_spins = ST_LOCK_WAIT_SPINS;
+			
+		} else if (status & _XABORT_CONFLICT) {
+			self->stats.n_retry_conflict++;
+			
+			if (self->lock_wait_spins > 0) {
+				// most likely the release of the lock we waited for
+				self->stats.n_lock_waits_cleared++;
+				self->lock_wait_spins = 0;
+			} else {
+				n_conflicts++;
+				ST_backoff(self, n_conflicts);
+			}
+			
+		} else {
+			self->stats.n_retry_other++;
+		}
+		
+		self->cur_segment_len = 0;
+		
+		if (unlikely(g_st_telemetry) && (n_htm_aborts <= g_st_split_params.max_htm_aborts)) {
+			self->p_cur_telemetry->n_attempts++;
+		}
+		
+		if (n_htm_aborts > g_st_split_params.max_htm_aborts) {
+			if (unlikely(g_st_telemetry)) {
+				self->p_cur_telemetry->n_slow_path++;
+			}
+			self->lock_wait_spins = 0;
+			self->is_slow_path = 1;
+			self->stats.n_slow_path_segments++;
+			MEMBARSTLD();
+			return;
+		}
+		
+	}
+	
+}
+
+void ST_split_segment_finish(st_thread_t *self) {
+	int new_limit;
+	st_segment_t *p_seg = self->p_cur_segment;
+		
+	self->split_counter++;
+	
+	if (unlikely(self->is_slow_path)) {
+		self->stats.n_splits++;
+		self->stats.n_split_length += self->cur_segment_len;
+		self->split_index++;
+		self->is_slow_path = 0;
+		MEMBARSTLD();
+		return;
+	}
+	
+	HTM_commit();
+	self->is_htm_active = 0;
+	self->lock_wait_spins = 0;
+	
+	p_seg->n_htm_success++;
+	self->stats.n_splits++;
+	if (unlikely(g_st_telemetry)) {
+		ST_telemetry_commit(self->p_cur_telemetry, self->cur_segment_len);
+	}
+	self->stats.n_split_length += self->cur_segment_len;
+
+	new_limit = ST_split_limit_clamp(self, 
+		self->p_split_policy->on_commit(p_seg, self->max_segment_len, &g_st_split_params));
+	if (new_limit != p_seg->n_limit) {
+		p_seg->n_limit = new_limit;
+		self->last_limit_change_op = self->stats.n_ops;
+		self->stats.n_limit_changes++;
+		
+		p_seg->saved_n_htm_success = p_seg->n_htm_success; 
+	}
+	
+	self->split_index++;
+	
+}
+
+void ST_split_save(st_thread_t *self) {
+	self->split_index_saved = self->split_index;
+}
+
+void ST_split_restore(st_thread_t *self) {
+	self->split_index = self->split_index_saved;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Slow-Path - Hazard Pointers
+///////////////////////////////////////////////////////////////////////////////
+void ST_HP_reset(st_thread_t *self) {	
+	self->n_hp_records = 0;	
+}
+
+volatile st_hp_record_t *ST_HP_alloc(st_thread_t *self) {	
+	int i;
+	volatile st_hp_record_t *p_hp;
+	
+	p_hp = &(self->hp_records[self->n_hp_records]);
+	self->n_hp_records++;
+	
+	if (self->n_hp_records >= ST_MAX_HP_RECORDS) {
+		abort();
+	}
+	
+	return p_hp;
+	
+}
+
+void ST_HP_init(volatile st_hp_record_t *p_hp, volatile int64_t **ptr_ptr) {
+	
+	while (1) { 
+		p_hp->ptr = *ptr_ptr;
+		MEMBARSTLD();	
+	
+		if (p_hp->ptr == *ptr_ptr) {
+			return;
+		}
+		
+		CPU_RELAX;
+	}
+	
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Reclamation - Scan Kernels
+//
+// A kernel scans one published stack range for a sorted set of candidate
+// pointers and marks the found ones. The byte kernel reads a word at every
+// byte offset (the original scan). The other kernels only read the 
+// pointer-aligned words of the range, since the compiler never places a 
+// pointer at an unaligned stack slot. An unaligned range start is handled 
+// by byte reads until the first aligned word, and an unaligned tail is 
+// skipped because no complete word fits in it.
+///////////////////////////////////////////////////////////////////////////////
+static int g_st_scan_kernel = ST_SCAN_KERNEL_BYTE;
+
+static inline void ST_scan_lookup(int64_t *ptr_val, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	int lo;
+	int hi;
+	int mid;
+	
+	if ((ptr_val < p_ptrs[0]) || (ptr_val > p_ptrs[n_ptrs-1])) {
+		return;
+	}
+	
+	lo = 0;
+	hi = n_ptrs - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) >> 1;
+		
+		if (p_ptrs[mid] == ptr_val) {
+			p_found[mid] = 1;
+			return;
+		}
+		
+		if (p_ptrs[mid] < ptr_val) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	
+}
+
+ST_NO_SANITIZE
+static long ST_scan_range_byte(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	unsigned char *p;
+	
+	for (p = p_start; p < p_end; p++) {
+		ST_scan_lookup(*(int64_t **)p, p_ptrs, n_ptrs, p_found);
+	}
+	
+	return p_end - p_start;
+}
+
+ST_NO_SANITIZE
+static inline unsigned char *ST_scan_range_head(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	unsigned char *p;
+	unsigned char *p_aligned;
+	
+	p_aligned = (unsigned char *)(((uintptr_t)p_start + sizeof(int64_t *) - 1) & ~(uintptr_t)(sizeof(int64_t *) - 1));
+	
+	for (p = p_start; (p < p_aligned) && (p + sizeof(int64_t *) <= p_end); p++) {
+		ST_scan_lookup(*(int64_t **)p, p_ptrs, n_ptrs, p_found);
+	}
+	
+	return p_aligned;
+}
+
+static inline int64_t **ST_scan_range_tail(unsigned char *p_end) {
+	return (int64_t **)((uintptr_t)p_end & ~(uintptr_t)(sizeof(int64_t *) - 1));
+}
+
+ST_NO_SANITIZE
+static long ST_scan_range_word(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	int64_t **p;
+	int64_t **p_words_end;
+	
+	p = (int64_t **)ST_scan_range_head(p_start, p_end, p_ptrs, n_ptrs, p_found);
+	p_words_end = ST_scan_range_tail(p_end);
+	
+	for (; p < p_words_end; p++) {
+		ST_scan_lookup(*p, p_ptrs, n_ptrs, p_found);
+	}
+	
+	return p_end - p_start;
+}
+
+// SSE2 has no 64-bit compare, so the equality is built from 32-bit halves
+static inline __m128i ST_cmpeq_epi64_sse2(__m128i a, __m128i b) {
+	__m128i eq32 = _mm_cmpeq_epi32(a, b);
+	return _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+ST_NO_SANITIZE
+static long ST_scan_range_sse2(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	int j;
+	int64_t **p;
+	int64_t **p_words_end;
+	__m128i v_words;
+	__m128i v_ptrs;
+	__m128i v_eq;
+	
+	if (n_ptrs > ST_SCAN_SIMD_MAX_PTRS) {
+		return ST_scan_range_word(p_start, p_end, p_ptrs, n_ptrs, p_found);
+	}
+	
+	p = (int64_t **)ST_scan_range_head(p_start, p_end, p_ptrs, n_ptrs, p_found);
+	p_words_end = ST_scan_range_tail(p_end);
+	
+	// 2 stack words against 2 candidates (and their swap) per step
+	for (; p + 2 <= p_words_end; p += 2) {
+		v_words = _mm_loadu_si128((__m128i *)p);
+		v_eq = _mm_setzero_si128();
+		
+		for (j = 0; j < n_ptrs; j += 2) {
+			v_ptrs = _mm_loadu_si128((__m128i *)&p_ptrs[j]);
+			v_eq = _mm_or_si128(v_eq, ST_cmpeq_epi64_sse2(v_words, v_ptrs));
+			v_eq = _mm_or_si128(v_eq, ST_cmpeq_epi64_sse2(v_words, _mm_shuffle_epi32(v_ptrs, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+		
+		if (unlikely(_mm_movemask_epi8(v_eq) != 0)) {
+			ST_scan_lookup(p[0], p_ptrs, n_ptrs, p_found);
+			ST_scan_lookup(p[1], p_ptrs, n_ptrs, p_found);
+		}
+	}
+	
+	for (; p < p_words_end; p++) {
+		ST_scan_lookup(*p, p_ptrs, n_ptrs, p_found);
+	}
+	
+	return p_end - p_start;
+}
+
+__attribute__((target("avx2"))) ST_NO_SANITIZE
+static long ST_scan_range_avx2(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	int j;
+	int64_t **p;
+	int64_t **p_words_end;
+	__m256i v_words;
+	__m256i v_ptrs;
+	__m256i v_eq;
+	__m256i v_min;
+	__m256i v_max;
+	__m256i v_out;
+	int out_mask;
+	
+	p = (int64_t **)ST_scan_range_head(p_start, p_end, p_ptrs, n_ptrs, p_found);
+	p_words_end = ST_scan_range_tail(p_end);
+	
+	if (n_ptrs <= ST_SCAN_SIMD_MAX_PTRS) {
+		// 4 stack words against 4 candidates (in all 4 rotations) per step
+		for (; p + 4 <= p_words_end; p += 4) {
+			v_words = _mm256_loadu_si256((__m256i *)p);
+			v_eq = _mm256_setzero_si256();
+			
+			for (j = 0; j < n_ptrs; j += 4) {
+				v_ptrs = _mm256_loadu_si256((__m256i *)&p_ptrs[j]);
+				v_eq = _mm256_or_si256(v_eq, _mm256_cmpeq_epi64(v_words, v_ptrs));
+				v_eq = _mm256_or_si256(v_eq, _mm256_cmpeq_epi64(v_words, _mm256_permute4x64_epi64(v_ptrs, _MM_SHUFFLE(0, 3, 2, 1))));
+				v_eq = _mm256_or_si256(v_eq, _mm256_cmpeq_epi64(v_words, _mm256_permute4x64_epi64(v_ptrs, _MM_SHUFFLE(1, 0, 3, 2))));
+				v_eq = _mm256_or_si256(v_eq, _mm256_cmpeq_epi64(v_words, _mm256_permute4x64_epi64(v_ptrs, _MM_SHUFFLE(2, 1, 0, 3))));
+			}
+			
+			if (unlikely(!_mm256_testz_si256(v_eq, v_eq))) {
+				for (j = 0; j < 4; j++) {
+					ST_scan_lookup(p[j], p_ptrs, n_ptrs, p_found);
+				}
+			}
+		}
+	} else {
+		// too many candidates for all-pairs compares: filter 4 stack words 
+		// against the candidates' [min, max] bounds (user-space pointers
+		// are positive, so the signed compare is safe)
+		v_min = _mm256_set1_epi64x((int64_t)p_ptrs[0]);
+		v_max = _mm256_set1_epi64x((int64_t)p_ptrs[n_ptrs-1]);
+		
+		for (; p + 4 <= p_words_end; p += 4) {
+			v_words = _mm256_loadu_si256((__m256i *)p);
+			v_out = _mm256_or_si256(_mm256_cmpgt_epi64(v_min, v_words), _mm256_cmpgt_epi64(v_words, v_max));
+			out_mask = _mm256_movemask_pd(_mm256_castsi256_pd(v_out));
+			
+			if (unlikely(out_mask != 0xF)) {
+				for (j = 0; j < 4; j++) {
+					if (!(out_mask & (1 << j))) {
+						ST_scan_lookup(p[j], p_ptrs, n_ptrs, p_found);
+					}
+				}
+			}
+		}
+	}
+	
+	for (; p < p_words_end; p++) {
+		ST_scan_lookup(*p, p_ptrs, n_ptrs, p_found);
+	}
+	
+	return p_end - p_start;
+}
+
+// p_ptrs must be sorted and padded with copies of its last entry up to a
+// multiple of ST_SCAN_SIMD_WIDTH entries
+static long ST_scan_range(unsigned char *p_start, unsigned char *p_end, int64_t **p_ptrs, int n_ptrs, char *p_found) {
+	if (p_end <= p_start) {
+		return 0;
+	}
+	
+	switch (g_st_scan_kernel) {
+		case ST_SCAN_KERNEL_AVX2:
+			return ST_scan_range_avx2(p_start, p_end, p_ptrs, n_ptrs, p_found);
+		case ST_SCAN_KERNEL_SSE2:
+			return ST_scan_range_sse2(p_start, p_end, p_ptrs, n_ptrs, p_found);
+		case ST_SCAN_KERNEL_WORD:
+			return ST_scan_range_word(p_start, p_end, p_ptrs, n_ptrs, p_found);
+		default:
+			return ST_scan_range_byte(p_start, p_end, p_ptrs, n_ptrs, p_found);
+	}
+}
+
+int ST_scan_kernel_init(int scan_kernel) {
+	if (scan_kernel == ST_SCAN_KERNEL_AUTO) {
+		scan_kernel = __builtin_cpu_supports("avx2") ? ST_SCAN_KERNEL_AVX2 : ST_SCAN_KERNEL_SSE2;
+	}
+	
+	if ((scan_kernel == ST_SCAN_KERNEL_AVX2) && (!__builtin_cpu_supports("avx2"))) {
+		printf("WARNING: AVX2 is not supported, using the SSE2 scan kernel\n");
+		scan_kernel = ST_SCAN_KERNEL_SSE2;
+	}
+	
+	g_st_scan_kernel = scan_kernel;
+	
+	return g_st_scan_kernel;
+}
+
+const char *ST_scan_kernel_name(int scan_kernel) {
+	switch (scan_kernel) {
+		case ST_SCAN_KERNEL_BYTE: return "byte";
+		case ST_SCAN_KERNEL_WORD: return "word";
+		case ST_SCAN_KERNEL_SSE2: return "sse2";
+		case ST_SCAN_KERNEL_AVX2: return "avx2";
+		default: return "auto";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Reclamation
+///////////////////////////////////////////////////////////////////////////////
+static inline long ST_get_nsec() {
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int ST_scan_thread_hp_records(st_thread_t *self, int64_t *ptr_to_free) {
+	int i;
+	
+	//printf("ST_scan_thread_hp_records: [%d] scan %d hp pointers\n", self->uniq_id, self->n_hp_records - 1);
+		
+	for (i = self->n_hp_records - 1; i >= 0; i--) {
+		if (self->hp_records[i].ptr == ptr_to_free) {
+			//printf("found HP pointer!\n");
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+int ST_scan_thread_stack(st_thread_t *self, int64_t *ptr_to_free, long *p_n_scan_bytes) {
+	int i;
+	int64_t *ptrs[ST_SCAN_SIMD_WIDTH];
+	char is_found;
+	
+	for (i = 0; i < ST_SCAN_SIMD_WIDTH; i++) {
+		ptrs[i] = ptr_to_free;
+	}
+	is_found = 0;
+	
+	for (i = self->n_stacks - 1; i >= 0; i--) {
+		//printf("stack scan: [%p] -> [%p]\n", self->stacks[i].p_start, self->stacks[i].p_end);
+		
+		*p_n_scan_bytes += ST_scan_range((unsigned char *)self->stacks[i].p_start,
+										 (unsigned char *)self->stacks[i].p_end,
+										 ptrs, 1, &is_found);
+		if (is_found) {
+			//printf("pointer found! ");
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+int ST_scan_thread(st_thread_t *self, int64_t *ptr_to_free, long *p_n_scan_bytes) {
+	int is_found;
+	
+	is_found = 0;
+	
+	if (unlikely(self->is_slow_path)) {
+		is_found = ST_scan_thread_hp_records(self, ptr_to_free);
+	}
+	
+	if (likely(!is_found)) {
+		is_found = ST_scan_thread_stack(self, ptr_to_free, p_n_scan_bytes);
+	}
+	
+	return is_found;	
+}
+
+// Frees the entries among the first n_scanned free list entries that were 
+// not found, and compacts the free list (entries past n_scanned are kept)
+void ST_free_not_found(st_thread_t *self, int n_scanned) {
+	int cur_index;
+	int new_size;
+	int n_freed;
+	
+	new_size = 0;
+	n_freed = 0;
+	for (cur_index = 0; cur_index < self->free_list_size; cur_index++) {
+
+		if ((cur_index < n_scanned) && (!self->free_list[cur_index].is_found)) {
+			ST_dealloc(self, self->free_list[cur_index].ptr_to_free);
+			n_freed++;
+			continue;
+		}
+		
+		self->free_list[new_size] = self->free_list[cur_index];
+		new_size++;
+	}
+	
+	ST_TRACE("[%d] ST_free_not_found: %d nodes freed of %d\n", self->uniq_id, n_freed, n_scanned);
+	
+	// a scan publishes its frees at once
+	ST_unreclaimed_add(self, 0, n_freed);
+	ST_unreclaimed_flush(self);
+
+	self->free_list_size = new_size;
+}
+
+void ST_scan_and_free_per_ptr(st_thread_t *self) {
+	int i;
+	int th_id;
+	st_thread_t *local_threads[ST_MAX_THREADS];
+	long local_stack_counters[ST_MAX_THREADS];
+	volatile long local_split_counter;
+	int local_n_threads;
+	st_thread_t *p_th;
+	
+	ST_TRACE("[%d] ST_scan_and_free_per_ptr: start\n", self->uniq_id);
+	
+	local_n_threads = ST_threads_acquire(self, local_threads, local_stack_counters);
+	
+	for (i = 0; i < self->free_list_size; i++) {
+		self->free_list[i].is_found = 0;
+	}
+	
+	for (th_id = 0; th_id < local_n_threads; th_id++) {
+		p_th = local_threads[th_id];
+		
+		HTM_exclude_start();
+		 
+		for (i = 0; i < self->free_list_size; i++) {
+			
+			if (self->free_list[i].is_found) {
+				continue;
+			}
+			
+			if (local_stack_counters[th_id] != p_th->stack_counter) {
+				break;
+			}
+
+			local_split_counter = p_th->split_counter;
+
+			if (ST_scan_thread(p_th, self->free_list[i].ptr_to_free, &(self->stats.n_scan_bytes))) {
+				self->free_list[i].is_found = 1;
+				continue;
+			}
+			
+			if (local_split_counter != p_th->split_counter) {
+				i--; // retry the same ptr
+			}
+			
+		}
+		
+		HTM_exclude_finish();
+	}
+	
+	ST_threads_release(local_threads, local_n_threads);
+	
+	ST_free_not_found(self, self->free_list_size);
+	
+	ST_TRACE("[%d] ST_scan_and_free_per_ptr: finish\n", self->uniq_id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Reclamation - Batched Scan
+//
+// The free list is sorted once per batch, and then every published stack 
+// word and hp record of every thread is read once and looked up in it. 
+// The scan cost is linear in the stack size instead of stack size times 
+// the free list size.
+///////////////////////////////////////////////////////////////////////////////
+static int ST_free_entry_cmp(const void *p_a, const void *p_b) {
+	int64_t *ptr_a = ((const free_entry_t *)p_a)->ptr_to_free;
+	int64_t *ptr_b = ((const free_entry_t *)p_b)->ptr_to_free;
+	
+	if (ptr_a < ptr_b) {
+		return -1;
+	}
+	
+	if (ptr_a > ptr_b) {
+		return 1;
+	}
+	
+	return 0;
+}
+
+void ST_scan_set_build(st_thread_t *self) {
+	int i;
+	
+	qsort(self->free_list, self->free_list_size, sizeof(free_entry_t), ST_free_entry_cmp);
+	
+	for (i = 0; i < self->free_list_size; i++) {
+		self->scan_ptrs[i] = self->free_list[i].ptr_to_free;
+		self->scan_found[i] = 0;
+	}
+	
+	for (; i % ST_SCAN_SIMD_WIDTH; i++) {
+		self->scan_ptrs[i] = self->scan_ptrs[self->free_list_size-1];
+	}
+	
+}
+
+void ST_scan_thread_hp_records_batch(st_thread_t *self, st_thread_t *p_th) {
+	int i;
+	
+	for (i = p_th->n_hp_records - 1; i >= 0; i--) {
+		ST_scan_lookup((int64_t *)p_th->hp_records[i].ptr, self->scan_ptrs, self->free_list_size, self->scan_found);
+	}
+	
+}
+
+void ST_scan_thread_stack_batch(st_thread_t *self, st_thread_t *p_th) {
+	int i;
+	
+	for (i = p_th->n_stacks - 1; i >= 0; i--) {
+		self->stats.n_scan_bytes += ST_scan_range((unsigned char *)p_th->stacks[i].p_start,
+												  (unsigned char *)p_th->stacks[i].p_end,
+												  self->scan_ptrs, self->free_list_size, self->scan_found);
+	}
+	
+}
+
+// Scans the stacks and hp records of one thread against the candidate set,
+// until the thread completes its operation or passes no segment boundary
+// during the scan. A software segment is not aborted by the unlink of a node
+// it holds in a register, so on the software backend no segment may run 
+// during the scan.
+void ST_scan_thread_batch(st_thread_t *self, st_thread_t *p_th, long stack_counter) {
+	volatile long local_split_counter;
+	
+	HTM_exclude_start();
+	
+	while (stack_counter == p_th->stack_counter) {
+		
+		local_split_counter = p_th->split_counter;
+		
+		if (unlikely(p_th->is_slow_path)) {
+			ST_scan_thread_hp_records_batch(self, p_th);
+		}
+		
+		ST_scan_thread_stack_batch(self, p_th);
+		
+		if (local_split_counter == p_th->split_counter) {
+			break;
+		}
+		
+		// the thread moved to a new segment during the scan, rescan it
+	}
+	
+	HTM_exclude_finish();
+}
+
+void ST_scan_and_free_batch(st_thread_t *self) {
+	int i;
+	int th_id;
+	st_thread_t *local_threads[ST_MAX_THREADS];
+	long local_stack_counters[ST_MAX_THREADS];
+	int local_n_threads;
+	
+	ST_TRACE("[%d] ST_scan_and_free_batch: start\n", self->uniq_id);
+	
+	if (self->free_list_size == 0) {
+		return;
+	}
+	
+	local_n_threads = ST_threads_acquire(self, local_threads, local_stack_counters);
+	
+	ST_scan_set_build(self);
+	
+	for (th_id = 0; th_id < local_n_threads; th_id++) {
+		ST_scan_thread_batch(self, local_threads[th_id], local_stack_counters[th_id]);
+	}
+	
+	ST_threads_release(local_threads, local_n_threads);
+	
+	for (i = 0; i < self->free_list_size; i++) {
+		self->free_list[i].is_found = self->scan_found[i];
+	}
+	
+	ST_free_not_found(self, self->free_list_size);
+	
+	ST_TRACE("[%d] ST_scan_and_free_batch: finish\n", self->uniq_id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Reclamation - Incremental Scan
+//
+// The batched scan is split into steps of one thread each. A scan starts 
+// when the free list is full: it snapshots the free list and the stack 
+// counters of the threads inside operations. Every completed operation then
+// scans one snapshotted thread, and the last step frees the not found 
+// pointers. A thread whose stack counter changed since the snapshot has 
+// completed the operation that could reference the snapshot, so it is 
+// skipped, exactly as in the full scan. Threads are identified by slot and
+// slot generation, so no slot reference is held between the steps.
+///////////////////////////////////////////////////////////////////////////////
+void ST_inc_scan_start(st_thread_t *self) {
+	int th_id;
+	st_thread_t *local_threads[ST_MAX_THREADS];
+	
+	self->inc_n_threads = ST_threads_acquire(self, local_threads, self->inc_stack_counters);
+	
+	for (th_id = 0; th_id < self->inc_n_threads; th_id++) {
+		self->inc_slot_ids[th_id] = local_threads[th_id]->uniq_id;
+		self->inc_slot_gens[th_id] = g_st_slots[local_threads[th_id]->uniq_id].gen;
+	}
+	
+	ST_threads_release(local_threads, self->inc_n_threads);
+	
+	ST_scan_set_build(self);
+	
+	self->inc_n_ptrs = self->free_list_size;
+	self->inc_cursor = 0;
+	self->is_inc_active = 1;
+}
+
+void ST_inc_scan_finish(st_thread_t *self) {
+	int i;
+	
+	for (i = 0; i < self->inc_n_ptrs; i++) {
+		self->free_list[i].is_found = self->scan_found[i];
+	}
+	
+	// the pointers freed after the scan start are kept for the next scan
+	ST_free_not_found(self, self->inc_n_ptrs);
+	
+	self->is_inc_active = 0;
+}
+
+// Scans the next snapshotted thread. Returns 1 when the scan completed.
+int ST_inc_scan_step(st_thread_t *self) {
+	int th_id;
+	st_slot_t *p_slot;
+	st_thread_t *p_th;
+	long start_nsec;
+	
+	start_nsec = ST_get_nsec();
+	
+	if (self->inc_cursor < self->inc_n_threads) {
+		th_id = self->inc_cursor;
+		p_slot = &(g_st_slots[self->inc_slot_ids[th_id]]);
+		
+		atomic_add(&(p_slot->n_refs), 1);
+		
+		p_th = (st_thread_t *)p_slot->p_thread;
+		if ((p_th != NULL) && (p_slot->gen == self->inc_slot_gens[th_id])) {
+			ST_scan_thread_batch(self, p_th, self->inc_stack_counters[th_id]);
+		}
+		
+		atomic_add(&(p_slot->n_refs), -1);
+		
+		self->inc_cursor++;
+		self->stats.n_scan_steps++;
+	}
+	
+	if (self->inc_cursor == self->inc_n_threads) {
+		ST_inc_scan_finish(self);
+		self->stats.n_scan_nsec += ST_get_nsec() - start_nsec;
+		return 1;
+	}
+	
+	self->stats.n_scan_nsec += ST_get_nsec() - start_nsec;
+	return 0;
+}
+
+void ST_scan_and_free_incremental(st_thread_t *self) {
+	
+	if (!self->is_inc_active) {
+		if (self->free_list_size == 0) {
+			return;
+		}
+		ST_inc_scan_start(self);
+	}
+	
+	while (!ST_inc_scan_step(self)) {}
+	
+}
+
+void ST_scan_and_free(st_thread_t *self) {
+	long start_nsec;
+	
+	start_nsec = ST_get_nsec();
+	
+	if (self->scan_mode == ST_SCAN_MODE_BATCH) {
+		ST_scan_and_free_batch(self);
+	} else if (self->scan_mode == ST_SCAN_MODE_INCREMENTAL) {
+		ST_scan_and_free_incremental(self);
+	} else {
+		ST_scan_and_free_per_ptr(self);
+	}
+	
+	self->stats.n_scan_nsec += ST_get_nsec() - start_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Background Reclamation
+//
+// In this mode ST_free only appends the pointer to a thread-local batch. 
+// Full batches are pushed to the thread's lock-free retire queue, and the 
+// reclaimer threads collect them, scan the stacks and free. A worker 
+// never scans, so it never waits for reclamation.
+///////////////////////////////////////////////////////////////////////////////
+static void ST_retire_push(st_thread_t *self, int64_t *ptr) {
+	
+	if (unlikely(self->p_retire_cur == NULL)) {
+		self->p_retire_cur = ST_batch_alloc(self->free_list_max_size);
+	}
+	
+	self->p_retire_cur->ptrs[self->p_retire_cur->n_ptrs] = ptr;
+	self->p_retire_cur->n_ptrs++;
+	
+	if (self->p_retire_cur->n_ptrs == self->p_retire_cur->max_ptrs) {
+		ST_batch_push(&(self->p_retired), self->p_retire_cur);
+		self->p_retire_cur = NULL;
+		self->stats.n_retire_batches++;
+	}
+	
+}
+
+// Detaches the retire queues of the workers that are assigned to this 
+// reclaimer (by slot), and the orphans, into the reclaimer's pending list
+static void ST_reclaimer_collect(st_reclaimer_t *p_rc) {
+	int slot_id;
+	int n_reclaimers;
+	long n_orphans;
+	st_slot_t *p_slot;
+	st_thread_t *p_th;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	n_reclaimers = g_st_n_reclaimers;
+	
+	for (slot_id = p_rc->id; slot_id < ST_MAX_THREADS; slot_id += n_reclaimers) {
+		p_slot = &(g_st_slots[slot_id]);
+		
+		if ((p_slot->p_thread == NULL) || 
+			((g_st_live_mask[slot_id / 64] & (((int64_t)1) << (slot_id % 64))) == 0)) {
+			continue;
+		}
+		
+		atomic_add(&(p_slot->n_refs), 1);
+		
+		p_th = (st_thread_t *)p_slot->p_thread;
+		if ((p_th != NULL) && (p_th->p_retired != NULL)) {
+			p_batch = ST_batch_pop_all(&(p_th->p_retired));
+			
+			while (p_batch != NULL) {
+				p_next = p_batch->p_next;
+				p_batch->p_next = p_rc->p_pending;
+				p_rc->p_pending = p_batch;
+				p_batch = p_next;
+			}
+		}
+		
+		atomic_add(&(p_slot->n_refs), -1);
+	}
+	
+	if ((p_rc->id == 0) && (g_st_orphans != NULL)) {
+		p_batch = ST_batch_pop_all(&g_st_orphans);
+		n_orphans = 0;
+		
+		while (p_batch != NULL) {
+			p_next = p_batch->p_next;
+			n_orphans += p_batch->n_ptrs;
+			p_batch->p_next = p_rc->p_pending;
+			p_rc->p_pending = p_batch;
+			p_batch = p_next;
+		}
+		
+		atomic_add(&g_n_orphans_pending, -n_orphans);
+		p_rc->p_st->stats.n_adopted += n_orphans;
+	}
+	
+}
+
+static void *ST_reclaimer_run(void *p_arg) {
+	int n_taken;
+	long start_nsec;
+	st_reclaimer_t *p_rc = (st_reclaimer_t *)p_arg;
+	st_thread_t *self = p_rc->p_st;
+	st_retire_batch_t *p_batch;
+	
+	ST_thread_init(self, &(p_rc->seed), 0, ST_MAX_FREE_LIST, g_st_reclaimer_scan_mode);
+	
+	while (!g_st_reclaimers_stop) {
+		start_nsec = ST_get_nsec();
+		
+		ST_reclaimer_collect(p_rc);
+		
+		n_taken = 0;
+		while ((p_rc->p_pending != NULL) && (self->free_list_size < ST_MAX_FREE_LIST)) {
+			p_batch = p_rc->p_pending;
+			n_taken += ST_batch_take(self, p_batch, ST_MAX_FREE_LIST);
+			
+			if (p_batch->n_ptrs == 0) {
+				p_rc->p_pending = p_batch->p_next;
+				free(p_batch);
+			}
+		}
+		
+		if (n_taken == 0) {
+			// nothing new: the still referenced pointers can wait
+			usleep(ST_RECLAIMER_IDLE_USEC);
+			continue;
+		}
+		
+		ST_scan_and_free(self);
+		self->stats.n_stack_scans++;
+		
+		p_rc->n_rounds++;
+		p_rc->n_busy_nsec += ST_get_nsec() - start_nsec;
+	}
+	
+	// whatever is left is handed over as orphans
+	while (p_rc->p_pending != NULL) {
+		p_batch = p_rc->p_pending;
+		p_rc->p_pending = p_batch->p_next;
+		
+		atomic_add(&g_n_orphans_pending, p_batch->n_ptrs);
+		self->stats.n_orphaned += p_batch->n_ptrs;
+		ST_batch_push(&g_st_orphans, p_batch);
+	}
+	
+	atomic_add(&g_st_reclaimers_busy_nsec, p_rc->n_busy_nsec);
+	atomic_add(&g_st_reclaimers_rounds, p_rc->n_rounds);
+	
+	ST_thread_finish(self);
+	
+	return NULL;
+}
+
+void ST_reclaimers_start(int n_reclaimers, int scan_mode) {
+	int i;
+	
+	if (n_reclaimers <= 0) {
+		return;
+	}
+	
+	g_st_reclaimers = (st_reclaimer_t *)calloc(n_reclaimers, sizeof(st_reclaimer_t));
+	if (g_st_reclaimers == NULL) {
+		abort();
+	}
+	
+	g_st_reclaimer_scan_mode = scan_mode;
+	g_st_reclaimers_stop = 0;
+	g_st_n_reclaimers = n_reclaimers;
+	g_st_n_reclaimers_started = n_reclaimers;
+	MEMBARSTLD();
+	
+	for (i = 0; i < n_reclaimers; i++) {
+		g_st_reclaimers[i].id = i;
+		g_st_reclaimers[i].seed = i + 1;
+		g_st_reclaimers[i].p_st = (st_thread_t *)malloc(sizeof(st_thread_t));
+		if (g_st_reclaimers[i].p_st == NULL) {
+			abort();
+		}
+		
+		if (pthread_create(&(g_st_reclaimers[i].thread), NULL, ST_reclaimer_run, &(g_st_reclaimers[i])) != 0) {
+			printf("ERROR: failed to create reclaimer thread %d\n", i);
+			abort();
+		}
+	}
+	
+}
+
+void ST_reclaimers_stop() {
+	int i;
+	int n_reclaimers;
+	
+	n_reclaimers = g_st_n_reclaimers;
+	if (n_reclaimers == 0) {
+		return;
+	}
+	
+	g_st_reclaimers_stop = 1;
+	
+	for (i = 0; i < n_reclaimers; i++) {
+		pthread_join(g_st_reclaimers[i].thread, NULL);
+		free(g_st_reclaimers[i].p_st);
+	}
+	
+	g_st_n_reclaimers = 0;
+	
+	free(g_st_reclaimers);
+	g_st_reclaimers = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Free
+///////////////////////////////////////////////////////////////////////////////
+void ST_free(st_thread_t *self, int64_t *ptr) {
+	
+#ifdef ST_FREE_DUPLICATE_CHECK
+	int i;
+	for (i = 0; i < self->free_list_size; i++) {
+		if (self->free_list[i].ptr_to_free == ptr) {
+			printf("ST_free: trying to free [%p] that is already in the free list.\n", ptr);
+		}
+	}
+#endif	
+	ST_unreclaimed_add(self, 1, 0);
+	
+	if (g_st_n_reclaimers > 0) {
+		ST_retire_push(self, ptr);
+		return;
+	}
+	
+	self->free_list[self->free_list_size].ptr_to_free = ptr;
+	self->free_list_size++;
+	
+	if (self->scan_mode == ST_SCAN_MODE_INCREMENTAL) {
+		if ((!self->is_inc_active) && (self->free_list_size >= self->free_list_max_size)) {
+			ST_inc_scan_start(self);
+		}
+		
+		// the steps did not keep up with the frees, complete the scan now
+		if (unlikely(self->free_list_size >= ST_MAX_FREE_LIST - 1)) {
+			while (self->free_list_size >= ST_MAX_FREE_LIST - 1) {
+				ST_scan_and_free(self);
+				self->stats.n_stack_scans++;
+			}
+		}
+		
+		return;
+	}
+	
+	if (self->free_list_size >= self->free_list_max_size) {
+		while (self->free_list_size >= self->free_list_max_size) {
+			ST_scan_and_free(self);
+			self->stats.n_stack_scans++;
+		}
+		
+		ST_orphans_adopt(self);
+	}
+	
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Epoch-Based Reclamation
+//
+// A thread announces the global epoch when it enters an operation, and 
+// keeps the nodes it retires in the limbo list of the current epoch. The 
+// epoch advances once every thread inside an operation announced it. A 
+// thread that announced epoch e entered before the advance to e + 1, and 
+// has exited before the advance to e + 2, so from then on nothing 
+// references the nodes retired in epoch e.
+///////////////////////////////////////////////////////////////////////////////
+void ST_EBR_enter(st_thread_t *self) {
+	self->ebr_announce = (g_st_epoch << 1) | 1;
+	MEMBARSTLD();
+}
+
+void ST_EBR_exit(st_thread_t *self) {
+	self->ebr_announce = 0;
+}
+
+// Returns 1 if the epoch advanced from epoch
+static int ST_EBR_try_advance(st_thread_t *self, int64_t epoch) {
+	int i;
+	int slot_id;
+	int64_t mask;
+	int64_t announce;
+	st_slot_t *p_slot;
+	st_thread_t *p_th;
+	
+	self->stats.n_epoch_scans++;
+	
+	for (i = 0; i < ST_LIVE_MASK_WORDS; i++) {
+		mask = g_st_live_mask[i];
+		
+		while (mask != 0) {
+			slot_id = (i * 64) + __builtin_ctzll(mask);
+			mask &= mask - 1;
+			
+			p_slot = &(g_st_slots[slot_id]);
+			atomic_add(&(p_slot->n_refs), 1);
+			
+			p_th = (st_thread_t *)p_slot->p_thread;
+			announce = (p_th != NULL) ? p_th->ebr_announce : 0;
+			
+			atomic_add(&(p_slot->n_refs), -1);
+			
+			if ((announce & 1) && ((announce >> 1) != epoch)) {
+				return 0;
+			}
+		}
+	}
+	
+	if (CAS(&g_st_epoch, epoch, epoch + 1) != epoch) {
+		return 0;
+	}
+	
+	self->stats.n_epoch_advances++;
+	
+	return 1;
+}
+
+static void ST_EBR_limbo_free(st_thread_t *self, st_ebr_limbo_t *p_limbo) {
+	int i;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	p_batch = p_limbo->p_batches;
+	
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
+		
+		for (i = 0; i < p_batch->n_ptrs; i++) {
+			ST_dealloc(self, p_batch->ptrs[i]);
+		}
+		
+		free(p_batch);
+		p_batch = p_next;
 	}
 	
-	//printf("ST_stack_add_range: [%ld] new [%p] [%p]\n", self->uniq_id, 
-	//													self->stacks[self->n_next_stack].p_start,
-	//													self->stacks[self->n_next_stack].p_end);
+	ST_unreclaimed_add(self, 0, p_limbo->n_ptrs);
+	self->ebr_n_limbo -= p_limbo->n_ptrs;
 	
+	p_limbo->p_batches = NULL;
+	p_limbo->n_ptrs = 0;
 }
 
-void ST_stack_publish(st_thread_t *self) {
-	self->n_stacks++;
-	self->n_next_stack = self->n_stacks;
-	MEMBARSTLD();
-}
-
-void ST_stack_del(st_thread_t *self) {
-	self->n_stacks--;
-	self->n_next_stack = self->n_stacks;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-// Stack Track - Split Management
-///////////////////////////////////////////////////////////////////////////////
-void ST_split_start(st_thread_t *self, int op_index) {
-	self->op_index = op_index;
-	self->split_index = 0;
+// Frees the limbo lists of the epochs before epoch - 1
+static void ST_EBR_free_safe(st_thread_t *self, int64_t epoch) {
+	int i;
+	st_ebr_limbo_t *p_limbo;
 	
-	if (self->is_slow_path) {
-		self->is_slow_path = 0;
+	for (i = 0; i < ST_EBR_N_EPOCHS; i++) {
+		p_limbo = &(self->ebr_limbo[i]);
+		if ((p_limbo->n_ptrs > 0) && (p_limbo->epoch + 2 <= epoch)) {
+			ST_EBR_limbo_free(self, p_limbo);
+		}
 	}
 	
-	ST_split_segment_start(self);
 }
 
-void ST_split_finish(st_thread_t *self) {
-	ST_split_segment_finish(self);
-	self->stats.n_ops++;
+// The limbo list of the epoch, after the older nodes in its entry were freed
+static st_ebr_limbo_t *ST_EBR_limbo_get(st_thread_t *self, int64_t epoch) {
+	st_ebr_limbo_t *p_limbo = &(self->ebr_limbo[epoch % ST_EBR_N_EPOCHS]);
+	
+	if (p_limbo->epoch != epoch) {
+		if (p_limbo->n_ptrs > 0) {
+			ST_EBR_limbo_free(self, p_limbo);
+		}
+		p_limbo->epoch = epoch;
+	}
+	
+	return p_limbo;
 }
 
-void ST_split_segment_start(st_thread_t *self) {
-	long saved_capacity_aborts;
-	long new_capacity_aborts;
-	long n_htm_aborts;
-		
-	saved_capacity_aborts = self->p_htm_data->n_xabort_capacity;
-
-	self->cur_segment_limit = self->segments[self->op_index][self->split_index].n_limit;
-	self->cur_segment_len = 0;
+// Frees the orphans that are old enough. The others join the current epoch, 
+// which is no earlier than theirs.
+static void ST_EBR_orphans_adopt(st_thread_t *self, int64_t epoch) {
+	int i;
+	st_ebr_limbo_t *p_limbo;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
 	
-	n_htm_aborts = 0;
+	if (likely(g_st_orphans == NULL)) {
+		return;
+	}
 	
-	self->is_htm_active = 1;
-	while (0 == HTM_start(self->p_htm_data)) {
-		self->is_htm_active = 0;
-
-		n_htm_aborts++;
-		
-		new_capacity_aborts = self->p_htm_data->n_xabort_capacity - saved_capacity_aborts;
+	p_limbo = ST_EBR_limbo_get(self, epoch);
+	p_batch = ST_batch_pop_all(&g_st_orphans);
+	
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
 		
-		if (new_capacity_aborts > 0) {
-			self->segments[self->op_index][self->split_index].saved_n_htm_success = self->segments[self->op_index][self->split_index].n_htm_success;
-		}
+		self->stats.n_adopted += p_batch->n_ptrs;
+		atomic_add(&g_n_orphans_pending, -p_batch->n_ptrs);
 		
-		if (new_capacity_aborts > ST_SEGMENT_MAX_CAPACITY_ABORTS_FOR_DEC) {
-			
-			if (self->segments[self->op_index][self->split_index].n_limit > ST_SEGMENT_MIN_LENGTH) {
-				self->segments[self->op_index][self->split_index].n_limit -= ST_SEGMENT_LEN_DELTA;
+		if (p_batch->epoch + 2 <= epoch) {
+			for (i = 0; i < p_batch->n_ptrs; i++) {
+				ST_dealloc(self, p_batch->ptrs[i]);
 			}
+			ST_unreclaimed_add(self, 0, p_batch->n_ptrs);
 			
-			saved_capacity_aborts = self->p_htm_data->n_xabort_capacity;
-			self->cur_segment_limit = self->segments[self->op_index][self->split_index].n_limit;
+			free(p_batch);
+			p_batch = p_next;
+			continue;
 		}
 		
-		self->cur_segment_len = 0;
+		p_batch->epoch = epoch;
+		p_limbo->n_ptrs += p_batch->n_ptrs;
+		self->ebr_n_limbo += p_batch->n_ptrs;
 		
-		if (n_htm_aborts > ST_SEGMENT_MAX_HTM_ABORTS) {
-			self->is_slow_path = 1;
-			self->stats.n_slow_path_segments++;
-			MEMBARSTLD();
-			return;
+		// behind the batch that takes the next retires
+		if (p_limbo->p_batches == NULL) {
+			p_batch->p_next = NULL;
+			p_limbo->p_batches = p_batch;
+		} else {
+			p_batch->p_next = p_limbo->p_batches->p_next;
+			p_limbo->p_batches->p_next = p_batch;
 		}
 		
+		p_batch = p_next;
 	}
 	
 }
 
-void ST_split_segment_finish(st_thread_t *self) {
-	long new_success;
-		
-	self->split_counter++;
+void ST_EBR_retire(st_thread_t *self, int64_t *ptr) {
+	int64_t epoch;
+	st_ebr_limbo_t *p_limbo;
+	st_retire_batch_t *p_batch;
 	
-	if (unlikely(self->is_slow_path)) {
-		self->stats.n_splits++;
-		self->stats.n_split_length += self->cur_segment_len;
-		self->split_index++;
-		self->is_slow_path = 0;
-		MEMBARSTLD();
+	ST_unreclaimed_add(self, 1, 0);
+	self->ebr_is_used = 1;
+	
+	epoch = g_st_epoch;
+	
+	p_limbo = ST_EBR_limbo_get(self, epoch);
+	p_batch = p_limbo->p_batches;
+	if ((p_batch == NULL) || (p_batch->n_ptrs == p_batch->max_ptrs)) {
+		p_batch = ST_batch_alloc(ST_EBR_BATCH_PTRS);
+		p_batch->epoch = epoch;
+		p_batch->p_next = p_limbo->p_batches;
+		p_limbo->p_batches = p_batch;
+	}
+	
+	p_batch->ptrs[p_batch->n_ptrs] = ptr;
+	p_batch->n_ptrs++;
+	p_limbo->n_ptrs++;
+	self->ebr_n_limbo++;
+	
+	self->ebr_n_retired_since_scan++;
+	if (self->ebr_n_retired_since_scan < self->free_list_max_size) {
 		return;
 	}
+	self->ebr_n_retired_since_scan = 0;
 	
-	HTM_commit();
-	self->is_htm_active = 0;
+	if (ST_EBR_try_advance(self, epoch)) {
+		epoch++;
+	} else {
+		epoch = g_st_epoch;
+	}
 	
-	self->segments[self->op_index][self->split_index].n_htm_success++;
-	self->stats.n_splits++;
-	self->stats.n_split_length += self->cur_segment_len;
+	ST_EBR_free_safe(self, epoch);
+	ST_EBR_orphans_adopt(self, epoch);
+}
 
-	new_success = self->segments[self->op_index][self->split_index].n_htm_success - self->segments[self->op_index][self->split_index].saved_n_htm_success;
-	if (new_success > ST_SEGMENT_MIN_SUCCESS_FOR_INC) {
-		if (self->segments[self->op_index][self->split_index].n_limit < self->max_segment_len) {
-			self->segments[self->op_index][self->split_index].n_limit += ST_SEGMENT_LEN_DELTA;
-						
-			self->segments[self->op_index][self->split_index].saved_n_htm_success = self->segments[self->op_index][self->split_index].n_htm_success; 
-		}
+// Frees what the epoch allows, and hands the rest to other threads. The 
+// orphans of threads that exited earlier are freed here too, since a short 
+// lived thread may never retire enough to try an advance.
+static void ST_EBR_thread_finish(st_thread_t *self) {
+	int i;
+	int64_t epoch;
+	st_ebr_limbo_t *p_limbo;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
+	
+	if (!self->ebr_is_used) {
+		return;
 	}
 	
-	self->split_index++;
+	epoch = g_st_epoch;
+	if (ST_EBR_try_advance(self, epoch)) {
+		epoch++;
+	}
+	ST_EBR_free_safe(self, epoch);
+	ST_EBR_orphans_adopt(self, epoch);
 	
-	if (self->split_index > ST_MAX_SEGMENTS) {
-		printf("ERROR: too many segments [%d] > [%d]\n", self->split_index, ST_MAX_SEGMENTS);
-		abort();
+	for (i = 0; i < ST_EBR_N_EPOCHS; i++) {
+		p_limbo = &(self->ebr_limbo[i]);
+		p_batch = p_limbo->p_batches;
+		
+		while (p_batch != NULL) {
+			p_next = p_batch->p_next;
+			
+			atomic_add(&g_n_orphans_pending, p_batch->n_ptrs);
+			self->stats.n_orphaned += p_batch->n_ptrs;
+			ST_batch_push(&g_st_orphans, p_batch);
+			
+			p_batch = p_next;
+		}
+		
+		p_limbo->p_batches = NULL;
+		p_limbo->n_ptrs = 0;
 	}
 	
+	self->ebr_n_limbo = 0;
 }
 
-void ST_split_save(st_thread_t *self) {
-	self->split_index_saved = self->split_index;
+///////////////////////////////////////////////////////////////////////////////
+// StackTrack - Interval-Based Reclamation
+//
+// 2GEIBR: an operation reserves [lower, upper], the era at its start and the 
+// era at its latest pointer read. A node is stamped with its birth era at
+// allocation and its retire era at retire, and a thread that references it
+// has a reservation that overlaps [birth, retire]. The global era advances 
+// with the allocations, so the reservation only moves, with a fence, every 
+// ST_IBR_ERA_ALLOCS allocations of any thread.
+///////////////////////////////////////////////////////////////////////////////
+void ST_IBR_start(st_thread_t *self) {
+	int64_t era = g_st_era;
+	
+	self->ibr_lower = era;
+	self->ibr_upper = era;
+	MEMBARSTLD();
 }
 
-void ST_split_restore(st_thread_t *self) {
-	self->split_index = self->split_index_saved;
+void ST_IBR_finish(st_thread_t *self) {
+	self->ibr_lower = ST_IBR_IDLE;
+	self->ibr_upper = ST_IBR_IDLE;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// StackTrack - Slow-Path - Hazard Pointers
-///////////////////////////////////////////////////////////////////////////////
-void ST_HP_reset(st_thread_t *self) {	
-	self->n_hp_records = 0;	
+void ST_IBR_reserve(st_thread_t *self, int64_t era) {
+	self->ibr_upper = era;
+	MEMBARSTLD();
+	
+	self->stats.n_era_reservations++;
 }
 
-volatile st_hp_record_t *ST_HP_alloc(st_thread_t *self) {	
-	int i;
-	volatile st_hp_record_t *p_hp;
+int64_t ST_IBR_alloc_era(st_thread_t *self) {
+	self->ibr_n_allocs++;
 	
-	p_hp = &(self->hp_records[self->n_hp_records]);
-	self->n_hp_records++;
-	
-	if (self->n_hp_records >= ST_MAX_HP_RECORDS) {
-		abort();
+	if (self->ibr_n_allocs >= ST_IBR_ERA_ALLOCS) {
+		self->ibr_n_allocs = 0;
+		atomic_add(&g_st_era, 1);
+		self->stats.n_era_advances++;
 	}
 	
-	return p_hp;
-	
+	return g_st_era;
 }
 
-void ST_HP_init(volatile st_hp_record_t *p_hp, volatile int64_t **ptr_ptr) {
+// Snapshots the reservations of the live threads. A thread that is idle now
+// may only reserve eras after the snapshot, when the nodes retired before it
+// are unreachable.
+static int ST_IBR_reservations(int64_t *p_lowers, int64_t *p_uppers) {
+	int i;
+	int slot_id;
+	int n_threads;
+	int64_t mask;
+	int64_t lower;
+	int64_t upper;
+	st_slot_t *p_slot;
+	st_thread_t *p_th;
 	
-	while (1) { 
-		p_hp->ptr = *ptr_ptr;
-		MEMBARSTLD();	
+	n_threads = 0;
 	
-		if (p_hp->ptr == *ptr_ptr) {
-			return;
-		}
+	for (i = 0; i < ST_LIVE_MASK_WORDS; i++) {
+		mask = g_st_live_mask[i];
 		
-		CPU_RELAX;
+		while (mask != 0) {
+			slot_id = (i * 64) + __builtin_ctzll(mask);
+			mask &= mask - 1;
+			
+			p_slot = &(g_st_slots[slot_id]);
+			atomic_add(&(p_slot->n_refs), 1);
+			
+			p_th = (st_thread_t *)p_slot->p_thread;
+			lower = ST_IBR_IDLE;
+			upper = ST_IBR_IDLE;
+			if (p_th != NULL) {
+				lower = p_th->ibr_lower;
+				upper = p_th->ibr_upper;
+			}
+			
+			atomic_add(&(p_slot->n_refs), -1);
+			
+			if (lower == ST_IBR_IDLE) {
+				continue;
+			}
+			
+			p_lowers[n_threads] = lower;
+			p_uppers[n_threads] = upper;
+			n_threads++;
+		}
 	}
 	
+	return n_threads;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// StackTrack - Reclamation
-///////////////////////////////////////////////////////////////////////////////
-int ST_scan_thread_hp_records(st_thread_t *self, int64_t *ptr_to_free) {
+static inline int ST_IBR_is_reserved(int64_t birth_era, int64_t retire_era, int64_t *p_lowers, int64_t *p_uppers, int n_threads) {
 	int i;
 	
-	//printf("ST_scan_thread_hp_records: [%d] scan %d hp pointers\n", self->uniq_id, self->n_hp_records - 1);
-		
-	for (i = self->n_hp_records - 1; i >= 0; i--) {
-		if (self->hp_records[i].ptr == ptr_to_free) {
-			//printf("found HP pointer!\n");
+	for (i = 0; i < n_threads; i++) {
+		if ((birth_era <= p_uppers[i]) && (retire_era >= p_lowers[i])) {
 			return 1;
 		}
 	}
@@ -317,157 +2584,266 @@ int ST_scan_thread_hp_records(st_thread_t *self, int64_t *ptr_to_free) {
 	return 0;
 }
 
-int ST_scan_thread_stack(st_thread_t *self, int64_t *ptr_to_free) {
+// Hands the retired nodes of self to other threads, as one batch with the 
+// interval that covers all of them
+static void ST_IBR_orphans_give(st_thread_t *self) {
 	int i;
-	unsigned char *p;
-	unsigned char *p_start;
-	unsigned char *p_end;
-	int64_t *ptr_val;
+	st_ibr_entry_t *p_entry;
+	st_retire_batch_t *p_batch;
 	
-	for (i = self->n_stacks - 1; i >= 0; i--) {
-		p_start = (unsigned char *)self->stacks[i].p_start;
-		p_end = (unsigned char *)self->stacks[i].p_end;
-		
-		//printf("stack scan: [%p] -> [%p]\n", p_start, p_end);
-		
-		for (p = p_start; p < p_end; p++) {
-			ptr_val = (*(int64_t **)p);
-			
-			if (ptr_val == ptr_to_free) {
-				//printf("pointer found! ");
-				return 1;
-			}	
-		}
+	if (self->ibr_n_retired == 0) {
+		return;
 	}
 	
-	return 0;
-}
-
-int ST_scan_thread(st_thread_t *self, int64_t *ptr_to_free) {
-	unsigned char *p;
-	unsigned char *p_start;
-	unsigned char *p_end;
-	int64_t *ptr_val;
-	int is_found;
-	
-	is_found = 0;
+	p_batch = ST_batch_alloc(self->ibr_n_retired);
+	p_batch->birth_era = ST_IBR_IDLE;
 	
-	if (unlikely(self->is_slow_path)) {
-		is_found = ST_scan_thread_hp_records(self, ptr_to_free);
+	for (i = 0; i < self->ibr_n_retired; i++) {
+		p_entry = &(self->ibr_retired[i]);
+		
+		p_batch->ptrs[i] = p_entry->ptr;
+		if (p_entry->birth_era < p_batch->birth_era) {
+			p_batch->birth_era = p_entry->birth_era;
+		}
+		if (p_entry->retire_era > p_batch->epoch) {
+			p_batch->epoch = p_entry->retire_era;
+		}
 	}
+	p_batch->n_ptrs = self->ibr_n_retired;
 	
-	if (likely(!is_found)) {
-		is_found = ST_scan_thread_stack(self, ptr_to_free);
-	}
+	atomic_add(&g_n_orphans_pending, self->ibr_n_retired);
+	self->stats.n_orphaned += self->ibr_n_retired;
+	self->ibr_n_retired = 0;
 	
-	return is_found;	
+	ST_batch_push(&g_st_orphans, p_batch);
 }
 
-void ST_scan_and_free(st_thread_t *self) {
+static void ST_IBR_scan_and_free(st_thread_t *self) {
 	int i;
-	int th_id;
-	volatile long local_stack_counters[ST_MAX_THREADS];
-	volatile long local_split_counter;
-	volatile long local_n_threads;
-	int max_index;
-	int cur_index;
-	int n_freed;
-	
-	ST_TRACE("[%d] ST_scan_and_free: start\n", self->uniq_id);
+	int n_threads;
+	int n_kept;
+	long n_freed;
+	int64_t lowers[ST_MAX_THREADS];
+	int64_t uppers[ST_MAX_THREADS];
+	st_ibr_entry_t *p_entry;
+	st_retire_batch_t *p_orphans;
+	st_retire_batch_t *p_batch;
+	st_retire_batch_t *p_next;
 	
-	local_n_threads = g_n_threads;
+	self->stats.n_era_scans++;
 	
-	for (th_id = 0; th_id < local_n_threads; th_id++) {
-		local_stack_counters[th_id] = g_st_threads[th_id]->stack_counter; 
+	// the orphans must be retired before the snapshot too
+	p_orphans = NULL;
+	if (unlikely(g_st_orphans != NULL)) {
+		p_orphans = ST_batch_pop_all(&g_st_orphans);
 	}
 	
-	for (i = 0; i < self->free_list_size; i++) {
-		self->free_list[i].is_found = 0;
-	}
+	n_threads = ST_IBR_reservations(lowers, uppers);
 	
-	for (th_id = 0; th_id < g_n_threads; th_id++) {
-		 
-		for (i = 0; i < self->free_list_size; i++) {
-			
-			if (self->free_list[i].is_found) {
-				continue;
-			}
-			
-			if (local_stack_counters[th_id] != g_st_threads[th_id]->stack_counter) {
-				break;
-			}
-
-			local_split_counter = g_st_threads[th_id]->split_counter;
-
-			if (ST_scan_thread((st_thread_t *)g_st_threads[th_id], self->free_list[i].ptr_to_free)) {
-				self->free_list[i].is_found = 1;
-				continue;
-			}
-			
-			if (local_split_counter != g_st_threads[th_id]->split_counter) {
-				i--; // retry the same ptr
-			}
-			
+	n_kept = 0;
+	n_freed = 0;
+	for (i = 0; i < self->ibr_n_retired; i++) {
+		p_entry = &(self->ibr_retired[i]);
+		
+		if (ST_IBR_is_reserved(p_entry->birth_era, p_entry->retire_era, lowers, uppers, n_threads)) {
+			self->ibr_retired[n_kept] = *p_entry;
+			n_kept++;
+			continue;
 		}
+		
+		ST_dealloc(self, p_entry->ptr);
+		n_freed++;
 	}
+	self->ibr_n_retired = n_kept;
 	
-	max_index = self->free_list_size;
-    cur_index = 0;
-	n_freed = 0;
-	while (cur_index < max_index) {
-
-		if (self->free_list[cur_index].is_found) {
-			cur_index++;
+	p_batch = p_orphans;
+	while (p_batch != NULL) {
+		p_next = p_batch->p_next;
+		
+		if (ST_IBR_is_reserved(p_batch->birth_era, p_batch->epoch, lowers, uppers, n_threads)) {
+			ST_batch_push(&g_st_orphans, p_batch);
+			p_batch = p_next;
 			continue;
 		}
 		
-		free(self->free_list[cur_index].ptr_to_free);
+		for (i = 0; i < p_batch->n_ptrs; i++) {
+			ST_dealloc(self, p_batch->ptrs[i]);
+		}
+		n_freed += p_batch->n_ptrs;
+		self->stats.n_adopted += p_batch->n_ptrs;
+		atomic_add(&g_n_orphans_pending, -p_batch->n_ptrs);
 		
-		self->free_list[cur_index].is_found = self->free_list[max_index-1].is_found;
-		self->free_list[cur_index].ptr_to_free = self->free_list[max_index-1].ptr_to_free;
-		n_freed++;
-		max_index--;
+		free(p_batch);
+		p_batch = p_next;
 	}
 	
-	ST_TRACE("[%d] ST_scan_and_free: %d nodes freed of %d\n", self->uniq_id, n_freed, self->free_list_size);
+	ST_unreclaimed_add(self, 0, n_freed);
+	ST_unreclaimed_flush(self);
+}
 
-	self->free_list_size = max_index;
+void ST_IBR_retire(st_thread_t *self, int64_t *ptr, int64_t birth_era) {
+	st_ibr_entry_t *p_entry;
+	
+	ST_unreclaimed_add(self, 1, 0);
+	self->ibr_is_used = 1;
+	
+	p_entry = &(self->ibr_retired[self->ibr_n_retired]);
+	p_entry->ptr = ptr;
+	p_entry->birth_era = birth_era;
+	p_entry->retire_era = g_st_era;
+	self->ibr_n_retired++;
+	
+	if (self->ibr_n_retired < self->free_list_max_size) {
+		return;
+	}
+	
+	ST_IBR_scan_and_free(self);
+	
+	// the reservations of stalled threads cover the whole list
+	if (unlikely(self->ibr_n_retired >= ST_MAX_FREE_LIST - 1)) {
+		ST_IBR_orphans_give(self);
+	}
 	
-	ST_TRACE("[%d] ST_scan_and_free: finish\n", self->uniq_id);
 }
 
-void ST_free(st_thread_t *self, int64_t *ptr) {
-	
-#ifdef ST_FREE_DUPLICATE_CHECK
-	int i;
-	for (i = 0; i < self->free_list_size; i++) {
-		if (self->free_list[i].ptr_to_free == ptr) {
-			printf("ST_free: trying to free [%p] that is already in the free list.\n", ptr);
-		}
+static void ST_IBR_thread_finish(st_thread_t *self) {
+	// the allocations of a short lived thread still move the era
+	if (self->ibr_n_allocs > 0) {
+		atomic_add(&g_st_era, 1);
+		self->stats.n_era_advances++;
 	}
-#endif	
-	self->free_list[self->free_list_size].ptr_to_free = ptr;
-	self->free_list_size++;
 	
-	if (self->free_list_size >= self->free_list_max_size) {
-		while (self->free_list_size >= self->free_list_max_size) {
-			ST_scan_and_free(self);
-			self->stats.n_stack_scans++;
-		}
+	if (!self->ibr_is_used) {
+		return;
 	}
 	
+	ST_IBR_scan_and_free(self);
+	ST_IBR_orphans_give(self);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // StackTrack - Stats
 ///////////////////////////////////////////////////////////////////////////////
+void ST_get_stats(st_stats_t *p_stats) {
+	memcpy(p_stats, (void *)&g_st_stats, sizeof(st_stats_t));
+}
+
+// Only between runs, when no thread is registered
+void ST_reset_stats() {
+	int op_index;
+	
+	memset((void *)&g_st_stats, 0, sizeof(st_stats_t));
+	g_st_n_unreclaimed = 0;
+	g_st_epoch = 0;
+	g_st_era = 0;
+	g_st_reclaimers_busy_nsec = 0;
+	g_st_reclaimers_rounds = 0;
+	g_st_n_reclaimers_started = 0;
+	
+	pthread_mutex_lock(&g_st_telemetry_lock);
+	for (op_index = 0; op_index < ST_MAX_OPS; op_index++) {
+		free(g_st_telemetry_tables[op_index].p_telemetry);
+		g_st_telemetry_tables[op_index].p_telemetry = NULL;
+		g_st_telemetry_tables[op_index].n_segments = 0;
+	}
+	pthread_mutex_unlock(&g_st_telemetry_lock);
+}
+
 void ST_print_stats() {
+	int i;
+	long n_htm_aborts = 0;
+	volatile st_split_policy_stats_t *p_policy_stats;
+	
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		n_htm_aborts += g_st_stats.n_op_htm_aborts[i];
+	}
+	
 	printf("-------------------------------------------------\n");
 	printf("  StackTrack status:\n");
 	printf("    n_splits_per_operation = %.2f\n", (double)(g_st_stats.n_splits) / (double)(g_st_stats.n_ops));
 	printf("    n_split_length = %.2f\n", (double)(g_st_stats.n_split_length) / (double)(g_st_stats.n_splits));
 	printf("    n_stack_scans = %lu\n", g_st_stats.n_stack_scans);
 	printf("    n_slow_path_segments = %lu\n", g_st_stats.n_slow_path_segments);
+	if (g_st_stats.n_scan_steps > 0) {
+		printf("    n_scan_steps = %lu (%.2f per scan)\n", g_st_stats.n_scan_steps,
+			g_st_stats.n_stack_scans ? (double)(g_st_stats.n_scan_steps) / (double)(g_st_stats.n_stack_scans) : 0.0);
+	}
+	printf("    n_scan_threads_scanned = %lu (%.2f per scan)\n", g_st_stats.n_scan_threads_scanned, 
+		g_st_stats.n_stack_scans ? (double)(g_st_stats.n_scan_threads_scanned) / (double)(g_st_stats.n_stack_scans) : 0.0);
+	printf("    n_scan_threads_skipped = %lu (%.2f per scan)\n", g_st_stats.n_scan_threads_skipped, 
+		g_st_stats.n_stack_scans ? (double)(g_st_stats.n_scan_threads_skipped) / (double)(g_st_stats.n_stack_scans) : 0.0);
+	printf("    n_orphaned = %lu\n", g_st_stats.n_orphaned);
+	printf("    n_adopted = %lu\n", g_st_stats.n_adopted);
+	printf("    n_orphans_pending = %lu\n", g_n_orphans_pending);
+	printf("    n_retired = %lu\n", g_st_stats.n_retired);
+	printf("    n_reclaimed = %lu\n", g_st_stats.n_reclaimed);
+	printf("    n_unreclaimed = %ld (peak %ld)\n", (long)g_st_n_unreclaimed, g_st_stats.n_unreclaimed_peak);
+	if (g_st_stats.n_epoch_scans > 0) {
+		printf("    n_epoch_advances = %lu (%lu scans, epoch %ld)\n", g_st_stats.n_epoch_advances, 
+			g_st_stats.n_epoch_scans, (long)g_st_epoch);
+	}
+	if (g_st_stats.n_era_scans > 0) {
+		printf("    n_era_advances = %lu (era %ld)\n", g_st_stats.n_era_advances, (long)g_st_era);
+		printf("    n_era_scans = %lu\n", g_st_stats.n_era_scans);
+		printf("    n_era_reservations = %lu\n", g_st_stats.n_era_reservations);
+	}
+	printf("    n_reclaimers = %d\n", g_st_n_reclaimers_started);
+	if (g_st_n_reclaimers_started > 0) {
+		printf("    n_retire_batches = %lu\n", g_st_stats.n_retire_batches);
+		printf("    reclaimer_rounds = %lu\n", g_st_reclaimers_rounds);
+		printf("    reclaimer_busy_ms = %.2f\n", (double)(g_st_reclaimers_busy_nsec) / 1000000.0);
+	}
+	printf("    scan_kernel = %s\n", ST_scan_kernel_name(g_st_scan_kernel));
+	printf("    allocator = %s\n", ST_allocator_name(g_st_alloc_type));
+	printf("    n_allocs = %lu (%.1f cycles per alloc)\n", g_st_stats.n_allocs, 
+		g_st_stats.n_allocs ? (double)(g_st_stats.n_alloc_cycles) / (double)(g_st_stats.n_allocs) : 0.0);
+	printf("    n_frees = %lu (%.1f cycles per free)\n", g_st_stats.n_frees, 
+		g_st_stats.n_frees ? (double)(g_st_stats.n_free_cycles) / (double)(g_st_stats.n_frees) : 0.0);
+	printf("    n_retry_conflict = %lu (%.1f backoff spins per retry)\n", g_st_stats.n_retry_conflict,
+		g_st_stats.n_retry_conflict ? (double)(g_st_stats.n_backoff_spins) / (double)(g_st_stats.n_retry_conflict) : 0.0);
+	printf("    n_retry_capacity = %lu\n", g_st_stats.n_retry_capacity);
+	printf("    n_retry_locked = %lu (%lu cleared while waiting)\n", g_st_stats.n_retry_locked, g_st_stats.n_lock_waits_cleared);
+	printf("    n_retry_other = %lu\n", g_st_stats.n_retry_other);
+	printf("    split_params = max_htm_aborts %d, min_length %d, len_delta %d, min_success_for_inc %d\n",
+		g_st_split_params.max_htm_aborts, g_st_split_params.min_length, 
+		g_st_split_params.len_delta, g_st_split_params.min_success_for_inc);
+	for (i = 0; i < ST_SPLIT_N_POLICIES; i++) {
+		p_policy_stats = &(g_st_stats.split_policies[i]);
+		if (p_policy_stats->n_threads == 0) {
+			continue;
+		}
+		printf("    split_policy[%s] = %ld threads, %.1f ops per thread, %.2f splits per op, length %.2f, "
+			"%.3f htm aborts per op, %ld slow path segments, %ld limit changes\n",
+			ST_split_policy_name(i), p_policy_stats->n_threads,
+			(double)(p_policy_stats->n_ops) / (double)(p_policy_stats->n_threads),
+			p_policy_stats->n_ops ? (double)(p_policy_stats->n_splits) / (double)(p_policy_stats->n_ops) : 0.0,
+			p_policy_stats->n_splits ? (double)(p_policy_stats->n_split_length) / (double)(p_policy_stats->n_splits) : 0.0,
+			p_policy_stats->n_ops ? (double)(p_policy_stats->n_htm_aborts) / (double)(p_policy_stats->n_ops) : 0.0,
+			p_policy_stats->n_slow_path_segments, p_policy_stats->n_limit_changes);
+	}
+	printf("    segment_model = %s\n", g_st_model_enabled ? "on" : "off");
+	printf("    n_model_publishes = %lu\n", g_st_stats.n_model_publishes);
+	printf("    early_htm_aborts_per_op = %.3f (first %d ops of a thread)\n", 
+		g_st_stats.n_early_ops ? (double)(g_st_stats.n_early_htm_aborts) / (double)(g_st_stats.n_early_ops) : 0.0, ST_EARLY_OPS);
+	printf("    htm_aborts_per_op = %.3f\n", g_st_stats.n_ops ? (double)(n_htm_aborts) / (double)(g_st_stats.n_ops) : 0.0);
+	printf("    ops_to_converge = %.1f (per thread, until its last limit change)\n", 
+		g_st_stats.n_model_threads ? (double)(g_st_stats.n_converge_ops) / (double)(g_st_stats.n_model_threads) : 0.0);
+	printf("    prealloc = %s\n", g_st_prealloc ? "on" : "off");
+	printf("    n_allocs_in_htm = %lu\n", g_st_stats.n_allocs_in_htm);
+	printf("    n_prealloc_reserved = %lu\n", g_st_stats.n_prealloc_reserved);
+	printf("    n_prealloc_recycled = %lu\n", g_st_stats.n_prealloc_recycled);
+	for (i = 0; i < ST_MAX_OPS; i++) {
+		if (g_st_stats.n_op_htm_aborts[i] > 0) {
+			printf("    n_htm_aborts[op %d] = %lu\n", i, g_st_stats.n_op_htm_aborts[i]);
+		}
+	}
+	printf("    n_scan_bytes = %lu\n", g_st_stats.n_scan_bytes);
+	printf("    scan_time_ms = %.2f\n", (double)(g_st_stats.n_scan_nsec) / 1000000.0);
+	printf("    scan_throughput_mb_per_sec = %.2f\n", g_st_stats.n_scan_nsec ? ((double)(g_st_stats.n_scan_bytes) * 1000.0) / (double)(g_st_stats.n_scan_nsec) : 0.0);
 	printf("-------------------------------------------------\n");
 	
+	if (g_st_alloc_type == ST_ALLOC_POOL) {
+		POOL_print_stats();
+	}
+	
 }
\ No newline at end of file
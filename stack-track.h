@@ -6,27 +6,97 @@
 // INCLUDES
 ///////////////////////////////////////////////////////////////////////////////
 #include "htm.h"
+#include "pool.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // DEFINES
 ///////////////////////////////////////////////////////////////////////////////
 #define ST_MAX_THREADS (100)
+#define ST_LIVE_MASK_WORDS ((ST_MAX_THREADS + 63) / 64)
 
 #define ST_MAX_FREE_LIST (1000)
 
+#define ST_RECLAIMER_IDLE_USEC (100)
+
+// A thread adds its retired and reclaimed nodes to the global unreclaimed 
+// count once they differ by this many
+#define ST_UNRECLAIMED_FLUSH (64)
+
+// Epoch-based reclamation: a node retired in epoch e is freed once the 
+// global epoch reaches e + 2, so a thread keeps the nodes of the last 
+// ST_EBR_N_EPOCHS epochs, in batches of ST_EBR_BATCH_PTRS
+#define ST_EBR_N_EPOCHS (3)
+#define ST_EBR_BATCH_PTRS (64)
+
+// Interval-based reclamation (2GEIBR): every thread advances the global era 
+// after this many node allocations. An idle thread reserves no era.
+#define ST_IBR_ERA_ALLOCS (128)
+#define ST_IBR_IDLE (INT64_MAX)
+
 #define ST_MAX_STACKS (20)
 #define ST_MAX_HP_RECORDS (100)
 
+#define ST_SCAN_MODE_PER_PTR (0)
+#define ST_SCAN_MODE_BATCH (1)
+#define ST_SCAN_MODE_INCREMENTAL (2)
+
+#define ST_SCAN_KERNEL_AUTO (-1)
+#define ST_SCAN_KERNEL_BYTE (0)
+#define ST_SCAN_KERNEL_WORD (1)
+#define ST_SCAN_KERNEL_SSE2 (2)
+#define ST_SCAN_KERNEL_AVX2 (3)
+
+// Candidate sets up to this size are compared all-pairs by the SIMD kernels
+#define ST_SCAN_SIMD_MAX_PTRS (8)
+#define ST_SCAN_SIMD_WIDTH (4)
+
+#define ST_ALLOC_MALLOC (0)
+#define ST_ALLOC_POOL (1)
+
 #define ST_MAX_OPS (20)
-#define ST_MAX_SEGMENTS (1000)
 
-// Segment adjustment parameters
+// A segment table starts with this many entries, and doubles when an 
+// operation passes its end
+#define ST_SEGMENTS_INIT (16)
+
+// The shared segment model covers the first segments of every operation 
+// type. Threads merge their learned limits into it every 
+// ST_MODEL_PUBLISH_OPS operations, and new segments start from it.
+#define ST_MODEL_MAX_SEGMENTS (64)
+#define ST_MODEL_PUBLISH_OPS (1024)
+
+// The first operations of a thread, for the early-life abort rate
+#define ST_EARLY_OPS (1000)
+
+// Segment split policies. A thread takes its policy at init, so a run may
+// mix several of them and compare them under the same load.
+#define ST_SPLIT_POLICY_ADDITIVE (0)
+#define ST_SPLIT_POLICY_MULTIPLICATIVE (1)
+#define ST_SPLIT_POLICY_FIXED (2)
+#define ST_SPLIT_N_POLICIES (3)
+
+// Default split policy parameters (st_split_params_t)
 #define ST_SEGMENT_MAX_HTM_ABORTS (50)
 #define ST_SEGMENT_MIN_LENGTH (5)
 #define ST_SEGMENT_LEN_DELTA (5)
-#define ST_SEGMENT_MAX_CAPACITY_ABORTS_FOR_DEC (4)
 #define ST_SEGMENT_MIN_SUCCESS_FOR_INC (4)
 
+// HTM retry policy: conflicts back off for a random number of spins, up 
+// to a bound that doubles with every conflict of the segment
+#define ST_BACKOFF_MIN_SPINS (16)
+#define ST_BACKOFF_MAX_SPINS (4096)
+
+// After an explicit lock abort, the retry spins this long on the busy lock
+#define ST_LOCK_WAIT_SPINS (1000)
+
+// Per-segment telemetry: abort counts by abort status bit (the six 
+// _XABORT_* bits, and a status without bits), the first explicit abort 
+// codes, and the segment lengths at commit (the last bucket counts the 
+// longer ones)
+#define ST_TELEMETRY_N_CAUSES (7)
+#define ST_TELEMETRY_MAX_CODES (4)
+#define ST_TELEMETRY_MAX_LEN (64)
+
 ///////////////////////////////////////////////////////////////////////////////
 // TYPES
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,6 +105,36 @@ typedef struct _free_entry_t {
 	int64_t *ptr_to_free;
 } free_entry_t;
 
+// A batch of retired pointers, passed between threads on lock-free stacks
+typedef struct _st_retire_batch_t {
+	struct _st_retire_batch_t *p_next;
+	// the epoch the pointers were retired in (epoch-based reclamation), or
+	// their latest retire era (interval-based reclamation)
+	int64_t epoch;
+	// their earliest birth era (interval-based reclamation)
+	int64_t birth_era;
+	int n_ptrs;
+	int max_ptrs;
+	int64_t *ptrs[];
+	
+} st_retire_batch_t;
+
+// The nodes a thread retired in one epoch
+typedef struct _st_ebr_limbo_t {
+	int64_t epoch;
+	long n_ptrs;
+	st_retire_batch_t *p_batches;
+	
+} st_ebr_limbo_t;
+
+// A node retired with interval-based reclamation, and its lifetime in eras
+typedef struct _st_ibr_entry_t {
+	int64_t *ptr;
+	int64_t birth_era;
+	int64_t retire_era;
+	
+} st_ibr_entry_t;
+
 typedef struct _stack_entry_t {
 	long flag;
 	volatile int64_t *p_start;	
@@ -53,15 +153,151 @@ typedef struct _st_segment_t {
 	
 } st_segment_t;
 
+typedef struct _st_segment_telemetry_t {
+	long n_attempts;
+	long n_commits;
+	long n_slow_path;
+	long n_aborts[ST_TELEMETRY_N_CAUSES];
+	int explicit_codes[ST_TELEMETRY_MAX_CODES];
+	long n_explicit_codes[ST_TELEMETRY_MAX_CODES];
+	long n_explicit_other;
+	long n_commit_lengths[ST_TELEMETRY_MAX_LEN + 1];
+	
+} st_segment_telemetry_t;
+
+// The learned segments of one operation type, allocated on its first use.
+// The telemetry grows with the segments, when it is enabled.
+typedef struct _st_segment_table_t {
+	int n_segments;
+	st_segment_t *p_segments;
+	st_segment_telemetry_t *p_telemetry;
+	
+} st_segment_table_t;
+
+typedef struct _st_split_params_t {
+	// HTM attempts of a segment before it runs on the slow path
+	int max_htm_aborts;
+	int min_length;
+	int len_delta;
+	// commits of a segment since its last change before it may grow
+	int min_success_for_inc;
+	
+} st_split_params_t;
+
+// A split policy adjusts the limit of a segment. The hooks run outside of
+// HTM and return the new limit, which the caller clamps to 
+// [min_length, max_segment_len].
+typedef struct _st_split_policy_t {
+	const char *name;
+	// starts from and publishes to the shared segment model
+	char uses_model;
+	int (*on_capacity_abort)(st_segment_t *p_seg, int max_segment_len, const st_split_params_t *p_params);
+	int (*on_commit)(st_segment_t *p_seg, int max_segment_len, const st_split_params_t *p_params);
+	
+} st_split_policy_t;
+
 typedef struct _st_thread_stats_t {
 	long n_ops;
 	long n_splits;
 	long n_split_length;
 	long n_stack_scans;
 	long n_slow_path_segments;
+	long n_scan_bytes;
+	long n_scan_nsec;
+	long n_orphaned;
+	long n_adopted;
+	long n_scan_threads_scanned;
+	long n_scan_threads_skipped;
+	long n_retire_batches;
+	long n_scan_steps;
+	long n_allocs;
+	long n_alloc_cycles;
+	long n_frees;
+	long n_free_cycles;
+	long n_allocs_in_htm;
+	long n_prealloc_reserved;
+	long n_prealloc_recycled;
+	long n_op_htm_aborts[ST_MAX_OPS];
+	long n_early_ops;
+	long n_early_htm_aborts;
+	long n_converge_ops;
+	long n_model_publishes;
+	long n_retry_conflict;
+	long n_retry_capacity;
+	long n_retry_locked;
+	long n_retry_other;
+	long n_backoff_spins;
+	long n_lock_waits_cleared;
+	long n_limit_changes;
+	long n_retired;
+	long n_reclaimed;
+	long n_unreclaimed_peak;
+	long n_epoch_scans;
+	long n_epoch_advances;
+	long n_era_scans;
+	long n_era_advances;
+	long n_era_reservations;
 	
 } st_thread_stats_t;
 		
+// The stats of the finished threads
+typedef struct _st_split_policy_stats_t {
+	long n_threads;
+	long n_ops;
+	long n_splits;
+	long n_split_length;
+	long n_htm_aborts;
+	long n_slow_path_segments;
+	long n_limit_changes;
+	
+} st_split_policy_stats_t;
+
+typedef struct _st_stats_t {
+	long n_ops;
+	long n_splits;
+	long n_split_length;
+	long n_stack_scans;
+	long n_slow_path_segments;
+	long n_scan_bytes;
+	long n_scan_nsec;
+	long n_orphaned;
+	long n_adopted;
+	long n_scan_threads_scanned;
+	long n_scan_threads_skipped;
+	long n_retire_batches;
+	long n_scan_steps;
+	long n_allocs;
+	long n_alloc_cycles;
+	long n_frees;
+	long n_free_cycles;
+	long n_allocs_in_htm;
+	long n_prealloc_reserved;
+	long n_prealloc_recycled;
+	long n_op_htm_aborts[ST_MAX_OPS];
+	long n_early_ops;
+	long n_early_htm_aborts;
+	long n_converge_ops;
+	long n_model_publishes;
+	long n_model_threads;
+	long n_retry_conflict;
+	long n_retry_capacity;
+	long n_retry_locked;
+	long n_retry_other;
+	long n_backoff_spins;
+	long n_lock_waits_cleared;
+	long n_retired;
+	long n_reclaimed;
+	// of all the threads together, since the last reset
+	long n_unreclaimed_peak;
+	long n_epoch_scans;
+	long n_epoch_advances;
+	long n_era_scans;
+	long n_era_advances;
+	long n_era_reservations;
+	st_split_policy_stats_t split_policies[ST_SPLIT_N_POLICIES];
+	
+} st_stats_t;
+
 typedef struct _st_thread_t { 
 	int64_t uniq_id;
 	int *p_seed;
@@ -81,6 +317,12 @@ typedef struct _st_thread_t {
 	htm_thread_data_t *p_htm_data;	
 	htm_thread_data_t htm_data;
 	
+	pool_t *p_pool;
+	
+	// a node allocated outside of HTM, and not yet linked
+	void *p_prealloc;
+	size_t prealloc_size;
+	
 	volatile long stack_counter;
 	volatile long n_next_stack;
 	volatile long n_stacks;
@@ -89,11 +331,56 @@ typedef struct _st_thread_t {
 	volatile long n_hp_records;
 	volatile st_hp_record_t hp_records[ST_MAX_HP_RECORDS];
 
-	st_segment_t segments[ST_MAX_OPS][ST_MAX_SEGMENTS];
-
+	int split_policy;
+	const st_split_policy_t *p_split_policy;
+	st_segment_table_t segment_tables[ST_MAX_OPS];
+	st_segment_t *p_cur_segment;
+	st_segment_telemetry_t *p_cur_telemetry;
+	// the operation count at the last change of a learned limit
+	long last_limit_change_op;
+	// set outside of HTM after a lock abort, and read by ST_LOCK_WAIT
+	int lock_wait_spins;
+
+	int scan_mode;
 	int free_list_max_size;	
 	int free_list_size;
 	free_entry_t free_list[ST_MAX_FREE_LIST];
+	
+	st_retire_batch_t *p_retire_cur;
+	st_retire_batch_t * volatile p_retired;
+	
+	// retired minus reclaimed nodes, not yet in the global count
+	long unreclaimed_delta;
+	
+	// epoch-based reclamation: (epoch << 1) | 1 inside an operation, and 0
+	// when idle
+	volatile int64_t ebr_announce;
+	st_ebr_limbo_t ebr_limbo[ST_EBR_N_EPOCHS];
+	long ebr_n_limbo;
+	int ebr_n_retired_since_scan;
+	// retired a node with EBR, so its orphans are EBR limbo lists
+	char ebr_is_used;
+	
+	// interval-based reclamation: the reserved eras, ST_IBR_IDLE when idle,
+	// and the retired nodes
+	volatile int64_t ibr_lower;
+	volatile int64_t ibr_upper;
+	int ibr_n_allocs;
+	char ibr_is_used;
+	int ibr_n_retired;
+	st_ibr_entry_t ibr_retired[ST_MAX_FREE_LIST];
+	
+	int64_t *scan_ptrs[ST_MAX_FREE_LIST + ST_SCAN_SIMD_WIDTH];
+	char scan_found[ST_MAX_FREE_LIST];
+	
+	// incremental scan state
+	char is_inc_active;
+	int inc_n_ptrs;
+	int inc_cursor;
+	int inc_n_threads;
+	int inc_slot_ids[ST_MAX_THREADS];
+	long inc_slot_gens[ST_MAX_THREADS];
+	long inc_stack_counters[ST_MAX_THREADS];
 
 	st_thread_stats_t stats;
 	
@@ -103,12 +390,15 @@ typedef struct _st_thread_t {
 // EXTERNAL FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////
 
-void ST_thread_init(st_thread_t *self, int *p_seed, int max_segment_len, int free_list_max_size);
+void ST_thread_init(st_thread_t *self, int *p_seed, int max_segment_len, int free_list_max_size, int scan_mode);
 void ST_thread_finish(st_thread_t *self);
 
 void ST_init(st_thread_t *self);
 void ST_finish(st_thread_t *self);
 
+// stack_counter is odd while the thread is inside an operation
+#define ST_IS_IN_OP(stack_counter) ((stack_counter) & 1)
+
 void ST_stack_init(st_thread_t *self);
 void ST_stack_add_range(st_thread_t *self, char *p_stack, int n_bytes);
 void ST_stack_publish(st_thread_t *self);
@@ -129,6 +419,14 @@ void ST_split_restore(st_thread_t *self);
 		ST_split_segment_start(self); \
 	} \
 
+// Inside HTM, after the segment aborted on a busy lock, spins on the lock.
+// Its release aborts the transaction with a conflict, so the retry runs 
+// as soon as the lock is free. No pause: it aborts RTM transactions.
+#define ST_LOCK_WAIT(self, p_lock) { \
+	int _n_spins = self->lock_wait_spins; \
+	while ((*(p_lock) != 0) && (_n_spins > 0)) { _n_spins--; } \
+}
+
 void ST_HP_reset(st_thread_t *self);
 volatile st_hp_record_t *ST_HP_alloc(st_thread_t *self);
 void ST_HP_init(volatile st_hp_record_t *p_hp, volatile int64_t **ptr_ptr);
@@ -137,6 +435,78 @@ void ST_HP_init(volatile st_hp_record_t *p_hp, volatile int64_t **ptr_ptr);
 
 void ST_free(st_thread_t *self, int64_t *ptr);
 
+// Epoch-based reclamation. An operation runs between enter and exit, and 
+// retires the nodes it unlinked. Every free_list_max_size retires, the 
+// thread tries to advance the global epoch, which needs every thread inside 
+// an operation to have announced the current epoch.
+void ST_EBR_enter(st_thread_t *self);
+void ST_EBR_exit(st_thread_t *self);
+void ST_EBR_retire(st_thread_t *self, int64_t *ptr);
+
+// Interval-based reclamation (2GEIBR). An operation reserves the eras from 
+// its start to its latest pointer read, and a node is freed once its 
+// lifetime, from its allocation to its retire, misses the reservation of 
+// every thread inside an operation. Unlike EBR, a stalled thread only holds 
+// the nodes that were alive during its reservation.
+extern volatile int64_t g_st_era;
+
+void ST_IBR_start(st_thread_t *self);
+void ST_IBR_finish(st_thread_t *self);
+void ST_IBR_reserve(st_thread_t *self, int64_t era);
+// The birth era of a new node
+int64_t ST_IBR_alloc_era(st_thread_t *self);
+void ST_IBR_retire(st_thread_t *self, int64_t *ptr, int64_t birth_era);
+
+// A pointer read is protected if the era is still the upper bound of the
+// reservation. Otherwise the bound moves to the era (a store and a fence, 
+// only when the era changed), and the pointer is read again.
+#define ST_IBR_READ(self, p_dst, ptr_ptr) { \
+	int64_t _era; \
+	while (1) { \
+		p_dst = *(ptr_ptr); \
+		_era = g_st_era; \
+		if (likely(_era == self->ibr_upper)) { break; } \
+		ST_IBR_reserve(self, _era); \
+	} \
+}
+
+// Counts a removed node that is never freed (no reclamation)
+void ST_leak(st_thread_t *self);
+
+// Retired nodes that are not freed yet. The nodes are counted by the thread
+// that retired them, and by the thread that freed them, so the count of a 
+// thread that frees nodes of others (reclaimers, adopted orphans) can be 
+// negative. The global count is exact up to ST_UNRECLAIMED_FLUSH nodes per
+// thread.
+long ST_thread_unreclaimed(st_thread_t *self);
+long ST_unreclaimed();
+
+void ST_allocator_init(int alloc_type);
+const char *ST_allocator_name(int alloc_type);
+void *ST_alloc(st_thread_t *self, size_t size);
+// Frees a node that no thread can reference any more, without a scan
+void ST_dealloc(st_thread_t *self, void *ptr);
+void ST_prealloc_init(int is_enabled);
+void *ST_prealloc_reserve(st_thread_t *self, size_t size);
+void ST_prealloc_take(st_thread_t *self);
+
+void ST_model_init(int is_enabled);
+
+// Threads take the policies round-robin by thread slot
+void ST_split_policy_init(const int *policies, int n_policies, const st_split_params_t *p_params);
+const char *ST_split_policy_name(int split_policy);
+
+void ST_telemetry_init(int is_enabled);
+int ST_telemetry_export(const char *path);
+
+void ST_reclaimers_start(int n_reclaimers, int scan_mode);
+void ST_reclaimers_stop();
+
+int ST_scan_kernel_init(int scan_kernel);
+const char *ST_scan_kernel_name(int scan_kernel);
+
+void ST_get_stats(st_stats_t *p_stats);
+void ST_reset_stats();
 void ST_print_stats();
 
 ///////////////////////////////////////////////////////////////////////////////
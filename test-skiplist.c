@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "htm.h"
+#include "skip-list.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// TYPES
+///////////////////////////////////////////////////////////////////////////////
+typedef int (*get_func_t)(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+typedef int (*put_func_t)(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t value, sl_value_t *p_old_value);
+typedef int (*remove_func_t)(st_thread_t *self, skiplist_t *p_skiplist, sl_key_t key, sl_value_t *p_value);
+
+typedef struct protocol {
+	const char *name;
+	get_func_t get;
+	put_func_t put;
+	remove_func_t remove;
+} protocol_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// GLOBALS
+///////////////////////////////////////////////////////////////////////////////
+static const protocol_t g_protocols[] = {
+	{"pure", skiplist_get_pure, skiplist_put_pure, skiplist_remove_pure},
+	{"hazard pointers", skiplist_get_hp, skiplist_put_hp, skiplist_remove_hp},
+	{"stack-track", skiplist_get_stacktrack, skiplist_put_stacktrack, skiplist_remove_stacktrack},
+	{"ebr", skiplist_get_ebr, skiplist_put_ebr, skiplist_remove_ebr},
+	{"ibr", skiplist_get_ibr, skiplist_put_ibr, skiplist_remove_ibr},
+};
+
+// The extreme keys are the keys of the sentinels
+static const sl_key_t g_keys[] = {MIN_KEY, 1, MAX_KEY - 1, MAX_KEY};
+
+#define N_PROTOCOLS ((int)(sizeof(g_protocols) / sizeof(g_protocols[0])))
+#define N_KEYS ((int)(sizeof(g_keys) / sizeof(g_keys[0])))
+
+static int g_n_failed = 0;
+
+#define CHECK(p_proto, cond) { \
+	if (!(cond)) { \
+		printf("FAIL [%s] %s:%d: %s\n", (p_proto)->name, __FILE__, __LINE__, #cond); \
+		g_n_failed++; \
+	} \
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TESTS
+///////////////////////////////////////////////////////////////////////////////
+
+// Every key, including the keys of the sentinels, is inserted, replaced,
+// found and removed, and the set is empty again
+static void test_extreme_keys(st_thread_t *self, const protocol_t *p_proto) {
+	int i;
+	sl_value_t value;
+	skiplist_t *p_skiplist;
+
+	p_skiplist = skiplist_init(N_KEYS);
+
+	for (i = 0; i < N_KEYS; i++) {
+		CHECK(p_proto, p_proto->get(self, p_skiplist, g_keys[i], &value) == 0);
+		CHECK(p_proto, p_proto->put(self, p_skiplist, g_keys[i], i, NULL) == 1);
+	}
+	CHECK(p_proto, skiplist_size(p_skiplist) == N_KEYS);
+
+	for (i = 0; i < N_KEYS; i++) {
+		value = 0;
+		CHECK(p_proto, p_proto->put(self, p_skiplist, g_keys[i], i + 100, &value) == 0);
+		CHECK(p_proto, value == (sl_value_t)i);
+		CHECK(p_proto, p_proto->get(self, p_skiplist, g_keys[i], &value) == 1);
+		CHECK(p_proto, value == (sl_value_t)(i + 100));
+	}
+
+	for (i = N_KEYS - 1; i >= 0; i--) {
+		value = 0;
+		CHECK(p_proto, p_proto->remove(self, p_skiplist, g_keys[i], &value) == 1);
+		CHECK(p_proto, value == (sl_value_t)(i + 100));
+		CHECK(p_proto, p_proto->remove(self, p_skiplist, g_keys[i], &value) == 0);
+		CHECK(p_proto, p_proto->get(self, p_skiplist, g_keys[i], &value) == 0);
+	}
+	CHECK(p_proto, skiplist_size(p_skiplist) == 0);
+
+	skiplist_destroy(self, p_skiplist);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MAIN
+///////////////////////////////////////////////////////////////////////////////
+int main() {
+	int i;
+	int seed = 1;
+	st_thread_t *p_st;
+
+	HTM_init(HTM_BACKEND_AUTO);
+
+	if ((p_st = (st_thread_t *)malloc(sizeof(st_thread_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+
+	for (i = 0; i < N_PROTOCOLS; i++) {
+		ST_thread_init(p_st, &seed, 50, 100, ST_SCAN_MODE_BATCH);
+		test_extreme_keys(p_st, &g_protocols[i]);
+		ST_thread_finish(p_st);
+	}
+
+	free(p_st);
+
+	if (g_n_failed > 0) {
+		printf("%d checks failed\n", g_n_failed);
+		return 1;
+	}
+
+	printf("All tests passed\n");
+	return 0;
+}